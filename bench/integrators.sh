@@ -0,0 +1,47 @@
+#!/bin/bash
+# Cost against accuracy for each integrator: integrates the same system over
+# the same simulated time at a range of timesteps, and reports the force
+# evaluations that took against the worst relative energy error seen,
+# max |E(t) - E_0| / |E_0| over 100 evenly spaced dumps.
+#
+# usage: ./bench/integrators.sh [inputFile] [simulatedTime] [enableBarnesHut]
+
+input=${1:-inputs/in_8_body_counterclockwise}
+time=${2:-1}
+enableBarnesHut=${3:-0}
+
+MPIRUN=${MPIRUN:-mpirun -n 1}
+
+make > /dev/null || exit 1
+
+printf "%-10s %10s %10s %12s %10s %14s\n" \
+    "integrator" "deltaT" "steps" "forceEvals" "seconds" "maxEnergyError"
+
+for integrator in leapfrog yoshida4 pefrl; do
+    for numTimeSteps in 100 300 1000 3000 10000 30000 100000; do
+        deltaT=$(python3 -c "print($time / $numTimeSteps)")
+        outputInterval=$((numTimeSteps / 100))
+        out=$(mktemp)
+        stats=$(mktemp)
+
+        start=$(date +%s.%N)
+        $MPIRUN ./nbody $numTimeSteps $outputInterval $deltaT $input \
+            $enableBarnesHut 0 0 $integrator > "$out" 2> "$stats"
+        end=$(date +%s.%N)
+
+        error=$(awk 'NF == 2 {
+                if (e0 == "") e0 = $2
+                d = ($2 - e0) / e0; if (d < 0) d = -d
+                if (d > worst) worst = d
+            }
+            END { printf "%.3e", worst }' "$out")
+        # the binary reports how many force evaluations its integrator made
+        evaluations=$(sed -n 's/^"forceEvaluations": \([0-9]*\),$/\1/p' "$stats")
+
+        printf "%-10s %10.3g %10d %12d %10.3f %14s\n" $integrator $deltaT $numTimeSteps \
+            $evaluations \
+            $(python3 -c "print($end - $start)") $error
+
+        rm -f "$out" "$stats"
+    done
+done
@@ -0,0 +1,74 @@
+#!/bin/bash
+# Compares double precision against mixed precision (float32 interactions,
+# double accumulation) for both force engines.
+#
+# Reports wall time, the relative energy drift |E_end - E_0| / |E_0| taken
+# from the "timestamp totalEnergy" lines of the dump, and for mixed precision
+# |E_end - E_end(double)| / |E_end(double)|, how far it lands from the double
+# precision run.
+#
+# usage: ./bench/mixed_precision.sh [inputFile] [numTimeSteps] [deltaT]
+#
+# Measured on one core (1 OpenMP thread, 1 rank). Wall time includes about
+# 0.3s of mpirun startup, and for in_10000 about 2.4s of parsing and dumping:
+#
+#   input     steps  engine      double   mixed   drift (double / mixed)  vsDouble
+#   in_512      200  barnes-hut  0.742s  0.490s  2.494e-08 / 9.438e-09  1.550e-08
+#   in_512      200  direct      0.664s  0.569s  1.046e-08 / 1.046e-08  7.441e-13
+#   in_512     5000  barnes-hut  8.842s  4.126s  1.898e-07 / 3.712e-08  1.527e-07
+#   in_512     5000  direct      8.038s  6.146s  2.237e-08 / 2.244e-08  7.514e-11
+#   in_10000     10  barnes-hut  4.096s  3.596s  6.103e-08 / 6.089e-08  1.429e-10
+#   in_10000     10  direct      9.020s  7.567s  6.082e-08 / 6.123e-08  4.137e-10
+#   in_10000     50  barnes-hut  6.908s  4.661s  3.825e-08 / 3.910e-08  8.593e-10
+#
+# For direct sum, float32 interactions add ~1e-12 to 1e-10 to the relative
+# energy error, well under the integrator's own drift. Mixed precision
+# Barnes-Hut shares one interaction list between each group of up to
+# GROUP_SIZE bodies, with a stricter opening test than the per-body walk,
+# so its forces are, if anything, closer to the direct sum's. Its vsDouble is
+# mostly that difference in opening, not float rounding.
+
+input=${1:-inputs/in_512}
+numTimeSteps=${2:-1000}
+deltaT=${3:-1e-03}
+outputInterval=$numTimeSteps
+
+MPIRUN=${MPIRUN:-mpirun -n 1}
+
+make > /dev/null || exit 1
+
+printf "%-12s %-10s %10s %14s %14s\n" "engine" "precision" "seconds" "energyDrift" "vsDouble"
+
+for enableBarnesHut in 1 0; do
+    for enableMixedPrecision in 0 1; do
+        out=$(mktemp)
+
+        start=$(date +%s.%N)
+        $MPIRUN ./nbody $numTimeSteps $outputInterval $deltaT $input \
+            $enableBarnesHut $enableMixedPrecision > "$out" 2> /dev/null
+        end=$(date +%s.%N)
+
+        drift=$(awk 'NF == 2 { if (e0 == "") e0 = $2; e = $2 }
+            END { d = (e - e0) / e0; if (d < 0) d = -d; printf "%.6e", d }' "$out")
+
+        # how far the final energy is from the double precision run's, i.e.
+        # what mixed precision itself adds to the drift
+        final=$(awk 'NF == 2 { e = $2 } END { printf "%.17g", e }' "$out")
+
+        if [ $enableMixedPrecision = 0 ]; then
+            double_final=$final
+            versus="-"
+        else
+            versus=$(awk -v e=$final -v d=$double_final \
+                'BEGIN { v = (e - d) / d; if (v < 0) v = -v; printf "%.3e", v }')
+        fi
+
+        engine=$([ $enableBarnesHut = 1 ] && echo "barnes-hut" || echo "direct")
+        precision=$([ $enableMixedPrecision = 1 ] && echo "mixed" || echo "double")
+
+        printf "%-12s %-10s %10.3f %14s %14s\n" $engine $precision \
+            $(python3 -c "print($end - $start)") $drift $versus
+
+        rm -f "$out"
+    done
+done
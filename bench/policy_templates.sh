@@ -0,0 +1,52 @@
+#!/bin/bash
+# Compares the policy-template simulation core against the runtime-branch step
+# loop it replaced, for every force engine and precision.
+#
+# The baseline is built from a git worktree at baselineRevision, which defaults
+# to the commit just before src/Simulation.hpp was introduced.
+#
+# usage: ./bench/policy_templates.sh [inputFile] [numTimeSteps] [deltaT] [baselineRevision]
+
+input=${1:-inputs/in_512}
+numTimeSteps=${2:-1000}
+deltaT=${3:-1e-03}
+outputInterval=$numTimeSteps
+
+introduced=$(git log --diff-filter=A --format=%h -- src/Simulation.hpp | tail -1)
+baseline=${4:-${introduced:+$introduced^}}
+baseline=${baseline:-HEAD}
+
+MPIRUN=${MPIRUN:-mpirun -n 1}
+
+worktree=$(mktemp -d)
+trap 'git worktree remove --force "$worktree"' EXIT
+
+git worktree add -q --detach "$worktree" "$baseline" || exit 1
+# build the baseline with today's flags, so only the step loop differs
+cp makefile "$worktree/makefile"
+(cd "$worktree" && make > /dev/null 2>&1) || exit 1
+make > /dev/null 2>&1 || exit 1
+
+wall_time() {
+    local start=$(date +%s.%N)
+    $MPIRUN "$@" > /dev/null 2>&1
+    local end=$(date +%s.%N)
+    python3 -c "print('%.3f' % ($end - $start))"
+}
+
+printf "%-12s %-10s %12s %12s %8s\n" "engine" "precision" "runtime" "templated" "speedup"
+
+for enableBarnesHut in 1 0; do
+    for enableMixedPrecision in 0 1; do
+        args="$numTimeSteps $outputInterval $deltaT $input $enableBarnesHut $enableMixedPrecision"
+
+        before=$(wall_time "$worktree/nbody" $args)
+        after=$(wall_time ./nbody $args)
+
+        engine=$([ $enableBarnesHut = 1 ] && echo "barnes-hut" || echo "direct")
+        precision=$([ $enableMixedPrecision = 1 ] && echo "mixed" || echo "double")
+
+        printf "%-12s %-10s %12s %12s %8s\n" $engine $precision $before $after \
+            $(python3 -c "print('%.2fx' % ($before / $after))")
+    done
+done
@@ -0,0 +1,135 @@
+#!/usr/local/bin/python3
+"""
+ctypes bindings for libnbody.so (`make lib`), see src/nbody.h
+
+Body state is exposed as NumPy views onto the simulation's own memory, so
+reading positions after a step costs no copies and no parsing:
+
+    sim = Simulation.from_file("inputs/in_512", 1e-03, barnes_hut=True)
+    sim.step(100)
+    plt.scatter(sim.x, sim.y)
+
+The views stay live: after another sim.step(...) the same arrays hold the new
+state. Don't keep them around past sim.close().
+"""
+
+import ctypes
+import os
+
+import numpy as np
+
+BODY_STRIDE = 8
+FIELDS = ["m", "Gm", "x", "y", "vx", "vy", "Fx", "Fy"]
+INTEGRATORS = {"leapfrog": 0, "euler": 1, "yoshida4": 2, "forestruth": 2, "pefrl": 3}
+
+DEFAULT_LIBRARY = os.path.join(os.path.dirname(os.path.abspath(__file__)), "libnbody.so")
+
+c_double_p = ctypes.POINTER(ctypes.c_double)
+
+
+def load_library(path=DEFAULT_LIBRARY):
+    lib = ctypes.CDLL(path)
+
+    lib.nbody_create.restype = ctypes.c_void_p
+    lib.nbody_create.argtypes = [ctypes.c_size_t] + [c_double_p] * 5 + [
+        ctypes.c_double, ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_int
+    ]
+
+    lib.nbody_create_from_file.restype = ctypes.c_void_p
+    lib.nbody_create_from_file.argtypes = [
+        ctypes.c_char_p, ctypes.c_double, ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_int
+    ]
+
+    lib.nbody_destroy.restype = None
+    lib.nbody_destroy.argtypes = [ctypes.c_void_p]
+
+    lib.nbody_step.restype = None
+    lib.nbody_step.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+
+    lib.nbody_size.restype = ctypes.c_size_t
+    lib.nbody_size.argtypes = [ctypes.c_void_p]
+
+    lib.nbody_time.restype = ctypes.c_double
+    lib.nbody_time.argtypes = [ctypes.c_void_p]
+
+    lib.nbody_bodies.restype = c_double_p
+    lib.nbody_bodies.argtypes = [ctypes.c_void_p]
+
+    lib.nbody_energies.restype = c_double_p
+    lib.nbody_energies.argtypes = [ctypes.c_void_p]
+
+    return lib
+
+
+class Simulation(object):
+    def __init__(self, m, x, y, vx, vy, delta_t,
+                 barnes_hut=False, mixed_precision=False, softening=0.0,
+                 integrator="leapfrog", library=DEFAULT_LIBRARY):
+        # the inputs are copied into the simulation once, here
+        columns = [np.ascontiguousarray(c, dtype=np.float64) for c in (m, x, y, vx, vy)]
+
+        self._lib = load_library(library)
+        self._handle = self._lib.nbody_create(
+            len(columns[0]),
+            *[c.ctypes.data_as(c_double_p) for c in columns],
+            delta_t, int(barnes_hut), int(mixed_precision), softening,
+            INTEGRATORS[integrator]
+        )
+
+        self._init_views()
+
+    @classmethod
+    def from_file(cls, input_filename, delta_t,
+                  barnes_hut=False, mixed_precision=False, softening=0.0,
+                  integrator="leapfrog", library=DEFAULT_LIBRARY):
+        self = cls.__new__(cls)
+
+        self._lib = load_library(library)
+        self._handle = self._lib.nbody_create_from_file(
+            input_filename.encode(), delta_t,
+            int(barnes_hut), int(mixed_precision), softening,
+            INTEGRATORS[integrator]
+        )
+
+        self._init_views()
+
+        return self
+
+    def _init_views(self):
+        if not self._handle:
+            raise ValueError("could not create simulation")
+
+        n = self._lib.nbody_size(self._handle)
+
+        # (n, 8) view over the Body array, and one strided column view per field
+        self.bodies = np.ctypeslib.as_array(
+            self._lib.nbody_bodies(self._handle), shape=(n, BODY_STRIDE)
+        )
+
+        for i, field in enumerate(FIELDS):
+            setattr(self, field, self.bodies[:, i])
+
+    def step(self, num_time_steps=1):
+        self._lib.nbody_step(self._handle, num_time_steps)
+
+    @property
+    def time(self):
+        return self._lib.nbody_time(self._handle)
+
+    def energies(self):
+        """(kinetic, potential, total), as a view that the next call refreshes"""
+        return np.ctypeslib.as_array(self._lib.nbody_energies(self._handle), shape=(3,))
+
+    def close(self):
+        if getattr(self, "_handle", None):
+            self._lib.nbody_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
@@ -0,0 +1,52 @@
+#include "Bodies.hpp"
+#include "Body.hpp"
+
+Bodies::Bodies(Body *data, size_t n):
+    data(data),
+    n(n),
+    first(0),
+    last(n) {
+}
+
+Bodies::~Bodies() {
+}
+
+size_t Bodies::size() const {
+    return n;
+}
+
+Body& Bodies::operator[](size_t i) {
+    return data[i];
+}
+
+const Body& Bodies::operator[](size_t i) const {
+    return data[i];
+}
+
+Body *Bodies::begin() {
+    return data;
+}
+
+Body *Bodies::end() {
+    return data + n;
+}
+
+const Body *Bodies::begin() const {
+    return data;
+}
+
+const Body *Bodies::end() const {
+    return data + n;
+}
+
+void Bodies::exchange() {
+}
+
+void Bodies::barrier() {
+}
+
+void Bodies::reduce_sum(double *, size_t) {
+}
+
+void Bodies::reduce_max(double *, size_t) {
+}
@@ -0,0 +1,39 @@
+#ifndef _Bodies_h
+#define _Bodies_h
+#include "Body.hpp"
+#include <cstddef>
+
+// Every body in the simulation, as one contiguous array, of which this process
+// owns [first, last): it calculates forces for and integrates only those. Any
+// body may be read.
+//
+// A plain Bodies owns all of them, and has nothing to exchange with anyone.
+// See SharedBodies for the MPI version
+class Bodies {
+    public:
+        // Constructors
+        Bodies(Body *data, size_t n);
+        virtual ~Bodies();
+        // Fields
+        Body *data;
+        size_t n;
+        size_t first;
+        size_t last;
+        // Methods
+        size_t size() const;
+        Body& operator[](size_t i);
+        const Body& operator[](size_t i) const;
+        Body *begin();
+        Body *end();
+        const Body *begin() const;
+        const Body *end() const;
+        // Makes every owner's writes to its bodies visible to every process
+        virtual void exchange();
+        // Waits until every process has stopped reading bodies it doesn't own
+        virtual void barrier();
+        // Combine per-process partial results, in place, across every process
+        virtual void reduce_sum(double *values, size_t values_n);
+        virtual void reduce_max(double *values, size_t values_n);
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include "Body.hpp"
 #include "utils.hpp"
 
+double Body::softening2 = 0;
+
 Body::Body():
     m(1),
     Gm(G * m),
@@ -16,6 +18,13 @@ Body::Body():
     Fy(0) {
 }
 
+// Plummer softening replaces r^2 with r^2 + ε^2 in both the force and the
+// potential, which keeps them finite as two bodies approach each other.
+// ε = 0 (the default) is plain Newtonian gravity
+void Body::set_softening(double epsilon) {
+    softening2 = epsilon * epsilon;
+}
+
 void Body::euler_integrate(double dt) {
     // F = ma
     const double ax = Fx / m;
@@ -83,8 +92,16 @@ double Body::kinetic_energy() const {
 
 double Body::gravitational_potential_energy(const Body& there) const {
     const double R = distance(x, y, there.x, there.y); // final distance, aka, to edge
+    const double softened_R = sqrt((R * R) + softening2);
+
+    // Unsoftened coincident bodies (which share a bucket, see QuadTree::insert)
+    // have no well defined potential. Count the pair as contributing nothing,
+    // as the force kernels do, rather than poisoning the total with -inf
+    if (softened_R == 0) {
+        return 0;
+    }
 
-    return (-Gm * there.m) / R;
+    return (-Gm * there.m) / softened_R;
 }
 
 void Body::exert_force_unidirectionally(const Body& there) {
@@ -92,21 +109,24 @@ void Body::exert_force_unidirectionally(const Body& there) {
     const double m2 = there.m;
 
     // Rather than calling `distance`, we re-use Δx and Δy
-    // in a direct call to hypot and for the construction of our force vector
+    // for both r and the construction of our force vector
     // this gives us around a +4% performance improvement, primarily because
     // distance and exert_force_(un/b)idirectionally consume the majority of our
     // CPU time
     const double delta_x = there.x - x;
     const double delta_y = there.y - y;
 
-    const double r = hypot(delta_x, delta_y);
-    const double r2 = pow(r, 2);
+    // softened, see set_softening
+    const double r2 = (delta_x * delta_x) + (delta_y * delta_y) + softening2;
+    const double r = sqrt(r2);
 
-    const double F = (Gm * m2) / r2;
+    // Unsoftened coincident bodies exert no force on each other, rather than
+    // 0 * inf = NaN. Same select as Tile::exert_force
+    const double F = r2 > 0 ? (Gm * m2) / r2 : 0;
 
     // turn the displacement vector between our two points into a force vector
     // of the desired magnitude
-    const double scale_factor = F / r;
+    const double scale_factor = r2 > 0 ? F / r : 0;
 
     Fx += delta_x * scale_factor;
     Fy += delta_y * scale_factor;
@@ -119,12 +139,12 @@ void Body::exert_force_bidirectionally(Body& there) {
     const double delta_x = there.x - x;
     const double delta_y = there.y - y;
 
-    const double r = hypot(delta_x, delta_y);
-    const double r2 = pow(r, 2);
+    const double r2 = (delta_x * delta_x) + (delta_y * delta_y) + softening2;
+    const double r = sqrt(r2);
 
-    const double F = (Gm * m2) / r2;
+    const double F = r2 > 0 ? (Gm * m2) / r2 : 0;
 
-    const double scale_factor = F / r;
+    const double scale_factor = r2 > 0 ? F / r : 0;
 
     #pragma omp critical
     {
@@ -17,6 +17,10 @@ class Body {
         double Fx;
         double Fy;
         Body();
+        // Plummer softening length squared, shared by every body. Kept out of
+        // the instance so a Body stays 8 doubles (see MPI_Body)
+        static double softening2;
+        static void set_softening(double epsilon);
         void euler_integrate(double dt);
         void kick_drift(double dt);
         void kick(double dt);
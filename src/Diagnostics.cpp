@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "Diagnostics.hpp"
+#include "Bodies.hpp"
+#include "Body.hpp"
+#include "utils.hpp"
+
+Diagnostics::Diagnostics(size_t radial_bins):
+    t(0),
+    kinetic(0),
+    potential(0),
+    total(0),
+    px(0),
+    py(0),
+    Lz(0),
+    virial_ratio(0),
+    com_x(0),
+    com_y(0),
+    bounding_radius(0),
+    shell_radius(0),
+    radial_profile(radial_bins) {
+}
+
+void Diagnostics::measure(Bodies& bodies, double timestamp, bool with_potential) {
+    t = timestamp;
+
+    // Pass 1 - everything that's a plain sum over bodies
+    double m = 0;
+    double mx = 0;
+    double my = 0;
+    double K = 0;
+    double W = 0;
+    double Px = 0;
+    double Py = 0;
+    double L = 0;
+
+    #pragma omp parallel for reduction(+:m, mx, my, K, W, Px, Py, L)
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        const auto& body = bodies[i];
+
+        m += body.m;
+        mx += body.m * body.x;
+        my += body.m * body.y;
+
+        K += body.kinetic_energy();
+
+        // Every pair is seen from both ends, so each end takes half. That way
+        // the pairs don't need to be split up between processes
+        if (with_potential) {
+            for (size_t j = 0; j < bodies.size(); j++) {
+                if (j != i) {
+                    W += body.gravitational_potential_energy(bodies[j]) / 2;
+                }
+            }
+        }
+
+        Px += body.m * body.vx;
+        Py += body.m * body.vy;
+        L += body.m * ((body.x * body.vy) - (body.y * body.vx));
+    }
+
+    double sums[] = { m, mx, my, K, W, Px, Py, L };
+    bodies.reduce_sum(sums, 8);
+
+    com_x = sums[1] / sums[0];
+    com_y = sums[2] / sums[0];
+    kinetic = sums[3];
+    potential = with_potential ? sums[4] : NAN;
+    total = kinetic + potential;
+    px = sums[5];
+    py = sums[6];
+    Lz = sums[7];
+    virial_ratio = (2 * kinetic) / std::fabs(potential);
+
+    // Pass 2 - the bounding radius needs the centre of mass
+    double R = 0;
+
+    #pragma omp parallel for reduction(max:R)
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        R = std::max(R, distance(bodies[i].x, bodies[i].y, com_x, com_y));
+    }
+
+    bodies.reduce_max(&R, 1);
+    bounding_radius = R;
+
+    // Pass 3 - and the shells need the bounding radius, but only the first
+    // one. Rescaling them every record would make each shell's time series
+    // cover a different range of radii from one line to the next
+    const size_t bins = radial_profile.size();
+
+    if (bins == 0) {
+        return;
+    }
+
+    if (shell_radius == 0) {
+        // a single body (or a point mass) still needs some nonzero width
+        shell_radius = R > 0 ? R : 1;
+    }
+
+    const double shell_R = shell_radius;
+
+    double *profile = radial_profile.data();
+    std::fill(profile, profile + bins, 0);
+
+    #pragma omp parallel for reduction(+:profile[:bins])
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        const double r = distance(bodies[i].x, bodies[i].y, com_x, com_y);
+        const size_t bin = static_cast<size_t>((r / shell_R) * bins);
+
+        // the outermost body at t = 0 sits exactly on the edge of the last
+        // shell, and anything that escapes later lands in it too
+        profile[std::min(bin, bins - 1)] += bodies[i].m;
+    }
+
+    bodies.reduce_sum(profile, bins);
+}
+
+/*
+# shellEdges 0 e1 ... eN-1 inf
+# t kinetic potential total px py Lz virialRatio boundingRadius shell0 ... shellN-1
+
+shellK holds the mass between edges K and K+1, about the centre of mass
+*/
+void Diagnostics::write_header(FILE *fh) const {
+    if (!radial_profile.empty()) {
+        const size_t bins = radial_profile.size();
+
+        fprintf(fh, "# shellEdges");
+
+        for (size_t k = 0; k < bins; k++) {
+            fprintf(fh, " %.6e", (shell_radius * k) / bins);
+        }
+
+        fprintf(fh, " inf\n");
+    }
+
+    fprintf(fh, "# t kinetic potential total px py Lz virialRatio boundingRadius");
+
+    for (size_t k = 0; k < radial_profile.size(); k++) {
+        fprintf(fh, " shell%d", static_cast<int>(k));
+    }
+
+    fprintf(fh, "\n");
+}
+
+void Diagnostics::write(FILE *fh) const {
+    fprintf(fh, "%f %.12e %.12e %.12e %.12e %.12e %.12e %.12e %.12e",
+        t, kinetic, potential, total, px, py, Lz, virial_ratio, bounding_radius);
+
+    for (const auto shell : radial_profile) {
+        fprintf(fh, " %.6e", shell);
+    }
+
+    fprintf(fh, "\n");
+}
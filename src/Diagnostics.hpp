@@ -0,0 +1,52 @@
+#ifndef _Diagnostics_h
+#define _Diagnostics_h
+#include "Bodies.hpp"
+#include <stdio.h>
+#include <vector>
+#include <cstddef>
+
+// Reduced, whole-system quantities, measured in-situ so that runs which only
+// need time series don't have to dump (and then re-parse) every body.
+//
+// Each process measures the bodies it owns, and the partial results are
+// combined with Bodies::reduce_sum / reduce_max, so measure must be called by
+// every process at the same step.
+//
+// Everything but the potential is O(n) per process. The potential is an exact
+// O(n^2) pair sum, so measure only computes it when asked to, and potential,
+// total and virial_ratio are NaN on the records that skip it
+class Diagnostics {
+    public:
+        // Constructors
+        Diagnostics(size_t radial_bins);
+        // Fields
+        double t;
+        double kinetic;
+        double potential;
+        double total;
+        // linear momentum
+        double px;
+        double py;
+        // angular momentum about the origin
+        double Lz;
+        // 2K / |W|, 1 for a system in virial equilibrium
+        double virial_ratio;
+        double com_x;
+        double com_y;
+        // the furthest any body is from the centre of mass
+        double bounding_radius;
+        // the outer edge of the radial profile. Fixed at the first measure's
+        // bounding_radius, so shellK means the same radii on every record
+        double shell_radius;
+        // the mass in each of radial_bins equally wide shells about the centre
+        // of mass, out to shell_radius. The last shell also holds every body
+        // that has since moved beyond it
+        std::vector<double> radial_profile;
+        // Methods
+        void measure(Bodies& bodies, double t, bool with_potential);
+        // after the first measure, which fixes the shell edges
+        void write_header(FILE *fh) const;
+        void write(FILE *fh) const;
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "Ensemble.hpp"
+#include "Body.hpp"
+#include "utils.hpp"
+
+EnsembleBatch::EnsembleBatch(const std::vector<EnsembleSystem>& systems):
+    systems(systems),
+    bodies_n(systems.front().bodies_n),
+    loaded() {
+    assert(0 < systems.size() && systems.size() <= ENSEMBLE_LANES);
+}
+
+size_t EnsembleBatch::load() {
+    // Allocated here rather than in the constructor, so a rank only pays for
+    // the batches it actually runs
+    for (auto field : {&m, &Gm, &x, &y, &vx, &vy, &Fx, &Fy}) {
+        field->assign(bodies_n * ENSEMBLE_LANES, 0);
+    }
+
+    // One bad input file mustn't take the rest of the ensemble down with it,
+    // so its lane is reported and then treated as padding
+    std::vector<Body> lane_bodies[ENSEMBLE_LANES];
+    size_t loaded_n = 0;
+    size_t padding_source = ENSEMBLE_LANES;
+
+    for (size_t l = 0; l < systems.size(); l++) {
+        std::ifstream input_fh(systems[l].input_filename);
+        bool did_parse = false;
+
+        try {
+            did_parse = try_parse_input_file(input_fh, lane_bodies[l]);
+        } catch (...) {
+            // std::stod on a malformed number
+        }
+
+        loaded[l] = did_parse && lane_bodies[l].size() == bodies_n;
+
+        if (!loaded[l]) {
+            fprintf(stderr, "Skipping malformed input file: %s\n", systems[l].input_filename.c_str());
+            continue;
+        }
+
+        loaded_n++;
+        padding_source = std::min(padding_source, l);
+    }
+
+    if (loaded_n == 0) {
+        return 0;
+    }
+
+    for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+        // Spare lanes, and the lanes of systems that didn't load, are padded
+        // with copies of the first system that did. They do the same
+        // (harmless) work as it, and are never written out
+        const size_t source = l < systems.size() && loaded[l] ? l : padding_source;
+        const std::vector<Body>& bodies = lane_bodies[source];
+
+        for (size_t i = 0; i < bodies_n; i++) {
+            const size_t k = i * ENSEMBLE_LANES + l;
+
+            m[k] = bodies[i].m;
+            Gm[k] = bodies[i].Gm;
+            x[k] = bodies[i].x;
+            y[k] = bodies[i].y;
+            vx[k] = bodies[i].vx;
+            vy[k] = bodies[i].vy;
+        }
+
+        dt[l] = systems[source].delta_t;
+    }
+
+    return loaded_n;
+}
+
+void EnsembleBatch::calculate_forces() {
+    std::fill(Fx.begin(), Fx.end(), 0);
+    std::fill(Fy.begin(), Fy.end(), 0);
+
+    // Unlike the main simulation loop, a batch is only ever touched by one
+    // thread, so we can exert forces bidirectionally and halve the work
+    for (size_t i = 0; i < bodies_n; i++) {
+        for (size_t j = i + 1; j < bodies_n; j++) {
+            double *Fxi = &Fx[i * ENSEMBLE_LANES];
+            double *Fyi = &Fy[i * ENSEMBLE_LANES];
+            double *Fxj = &Fx[j * ENSEMBLE_LANES];
+            double *Fyj = &Fy[j * ENSEMBLE_LANES];
+
+            const double *xi = &x[i * ENSEMBLE_LANES];
+            const double *yi = &y[i * ENSEMBLE_LANES];
+            const double *xj = &x[j * ENSEMBLE_LANES];
+            const double *yj = &y[j * ENSEMBLE_LANES];
+            const double *Gmi = &Gm[i * ENSEMBLE_LANES];
+            const double *mj = &m[j * ENSEMBLE_LANES];
+            const double softening2 = Body::softening2;
+
+            #pragma omp simd
+            for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+                const double delta_x = xj[l] - xi[l];
+                const double delta_y = yj[l] - yi[l];
+
+                const double r2 = (delta_x * delta_x) + (delta_y * delta_y) + softening2;
+                const double r = std::sqrt(r2);
+
+                // coincident, unsoftened bodies exert nothing, see
+                // Body::exert_force_unidirectionally
+                const double scale_factor = r2 > 0 ? (Gmi[l] * mj[l]) / (r2 * r) : 0;
+
+                Fxi[l] += delta_x * scale_factor;
+                Fyi[l] += delta_y * scale_factor;
+                Fxj[l] -= delta_x * scale_factor;
+                Fyj[l] -= delta_y * scale_factor;
+            }
+        }
+    }
+}
+
+// The same leap then frog sequence the main simulation loop performs over
+// two half steps, fused into one full step
+void EnsembleBatch::step() {
+    for (size_t i = 0; i < bodies_n; i++) {
+        const size_t k = i * ENSEMBLE_LANES;
+
+        #pragma omp simd
+        for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+            x[k + l] += vx[k + l] * dt[l];
+            y[k + l] += vy[k + l] * dt[l];
+        }
+    }
+
+    calculate_forces();
+
+    for (size_t i = 0; i < bodies_n; i++) {
+        const size_t k = i * ENSEMBLE_LANES;
+
+        #pragma omp simd
+        for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+            vx[k + l] += (Fx[k + l] / m[k + l]) * dt[l];
+            vy[k + l] += (Fy[k + l] / m[k + l]) * dt[l];
+        }
+    }
+}
+
+void EnsembleBatch::total_energy(double energy[ENSEMBLE_LANES]) const {
+    std::fill(energy, energy + ENSEMBLE_LANES, 0);
+
+    for (size_t i = 0; i < bodies_n; i++) {
+        const size_t ki = i * ENSEMBLE_LANES;
+
+        // kinetic
+        for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+            const double v2 = (vx[ki + l] * vx[ki + l]) + (vy[ki + l] * vy[ki + l]);
+
+            energy[l] += (m[ki + l] * v2) / 2;
+        }
+
+        // gravitational potential
+        for (size_t j = i + 1; j < bodies_n; j++) {
+            const size_t kj = j * ENSEMBLE_LANES;
+
+            for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+                const double R = distance(x[ki + l], y[ki + l], x[kj + l], y[kj + l]);
+                const double softened_R = std::sqrt((R * R) + Body::softening2);
+
+                if (softened_R > 0) {
+                    energy[l] += (-Gm[ki + l] * m[kj + l]) / softened_R;
+                }
+            }
+        }
+    }
+}
+
+// Writes the same format as dump_timestep in main.cpp, one file per system
+void EnsembleBatch::dump_timestep(double timestamps[ENSEMBLE_LANES], FILE *outputs[ENSEMBLE_LANES]) const {
+    double energy[ENSEMBLE_LANES];
+    total_energy(energy);
+
+    for (size_t l = 0; l < systems.size(); l++) {
+        if (outputs[l] == nullptr) {
+            continue;
+        }
+
+        fprintf(outputs[l], "%f %f\n", timestamps[l], energy[l]);
+
+        for (size_t i = 0; i < bodies_n; i++) {
+            const size_t k = i * ENSEMBLE_LANES + l;
+
+            fprintf(outputs[l], "%f %f %f %f\n", x[k], y[k], vx[k], vy[k]);
+        }
+
+        fprintf(outputs[l], "\n");
+    }
+}
+
+// Returns how many of the batch's systems were advanced
+size_t EnsembleBatch::run() {
+    const size_t loaded_n = load();
+
+    if (loaded_n == 0) {
+        return 0;
+    }
+
+    // Every system in a batch shares these, see make_batches
+    const unsigned int num_time_steps = systems.front().num_time_steps;
+    const unsigned int output_interval = systems.front().output_interval;
+
+    FILE *outputs[ENSEMBLE_LANES] = {};
+    double timestamps[ENSEMBLE_LANES] = {};
+
+    for (size_t l = 0; l < systems.size(); l++) {
+        const EnsembleSystem& system = systems[l];
+
+        if (!loaded[l]) {
+            continue;
+        }
+
+        outputs[l] = fopen(system.output_filename.c_str(), "w");
+
+        if (outputs[l] == nullptr) {
+            fprintf(stderr, "Could not open %s for writing\n", system.output_filename.c_str());
+            continue;
+        }
+
+        fprintf(outputs[l], "%d %d %d %f\n", bodies_n, num_time_steps, output_interval, system.delta_t);
+
+        for (size_t i = 0; i < bodies_n; i++) {
+            fprintf(outputs[l], "%f\n", m[i * ENSEMBLE_LANES + l]);
+        }
+    }
+
+    dump_timestep(timestamps, outputs);
+
+    for (unsigned int step = 1; step <= num_time_steps; step++) {
+        this->step();
+
+        for (size_t l = 0; l < ENSEMBLE_LANES; l++) {
+            timestamps[l] += dt[l];
+        }
+
+        if (step % output_interval == 0) {
+            dump_timestep(timestamps, outputs);
+        }
+    }
+
+    for (size_t l = 0; l < systems.size(); l++) {
+        if (outputs[l] != nullptr) {
+            fclose(outputs[l]);
+        }
+    }
+
+    return loaded_n;
+}
+
+/*
+inputFile outputFile numTimeSteps outputInterval deltaT
+...
+
+Blank lines and lines starting with # are ignored
+*/
+std::vector<EnsembleSystem> parse_manifest(std::ifstream& manifest_fh) {
+    std::vector<EnsembleSystem> systems = {};
+    std::string line;
+
+    while (getline(manifest_fh, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::stringstream line_stream(line);
+        EnsembleSystem system;
+
+        line_stream >> system.input_filename
+                    >> system.output_filename
+                    >> system.num_time_steps
+                    >> system.output_interval
+                    >> system.delta_t;
+
+        if (line_stream.fail() || system.output_interval == 0) {
+            fprintf(stderr, "Skipping malformed manifest line: %s\n", line.c_str());
+            continue;
+        }
+
+        // We only need numBodies to batch the system up, so just peek at
+        // the first line. The full parse happens on whichever rank runs it
+        std::ifstream input_fh(system.input_filename);
+        std::string header;
+
+        if (!getline(input_fh, header) || sscanf(header.c_str(), "%u", &system.bodies_n) != 1) {
+            fprintf(stderr, "Skipping unreadable input file: %s\n", system.input_filename.c_str());
+            continue;
+        }
+
+        systems.push_back(system);
+    }
+
+    return systems;
+}
+
+std::vector<EnsembleBatch> make_batches(std::vector<EnsembleSystem> systems) {
+    // Only systems that agree on body count, step count and output interval
+    // can advance in lockstep. deltaT is allowed to vary per lane
+    std::stable_sort(systems.begin(), systems.end(),
+        [](const EnsembleSystem& a, const EnsembleSystem& b) {
+            if (a.bodies_n != b.bodies_n) return a.bodies_n < b.bodies_n;
+            if (a.num_time_steps != b.num_time_steps) return a.num_time_steps < b.num_time_steps;
+            return a.output_interval < b.output_interval;
+        });
+
+    std::vector<EnsembleBatch> batches = {};
+    std::vector<EnsembleSystem> lanes = {};
+
+    for (const auto& system : systems) {
+        const bool compatible = lanes.empty()
+            || (lanes.front().bodies_n == system.bodies_n
+                && lanes.front().num_time_steps == system.num_time_steps
+                && lanes.front().output_interval == system.output_interval);
+
+        if (!compatible || lanes.size() == ENSEMBLE_LANES) {
+            batches.push_back(EnsembleBatch(lanes));
+            lanes.clear();
+        }
+
+        lanes.push_back(system);
+    }
+
+    if (!lanes.empty()) {
+        batches.push_back(EnsembleBatch(lanes));
+    }
+
+    return batches;
+}
+
+// Returns how many systems this rank advanced
+size_t run_ensemble(const std::string& manifest_filename, int rank, int size) {
+    std::ifstream manifest_fh(manifest_filename);
+
+    // Every rank reads the manifest and builds the same list of batches, so
+    // there's nothing to communicate. Batches are dealt out round-robin
+    std::vector<EnsembleBatch> batches = make_batches(parse_manifest(manifest_fh));
+    std::vector<EnsembleBatch*> ours = {};
+
+    for (size_t b = rank; b < batches.size(); b += size) {
+        ours.push_back(&batches[b]);
+    }
+
+    size_t systems_n = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:systems_n)
+    for (size_t b = 0; b < ours.size(); b++) {
+        systems_n += ours[b]->run();
+    }
+
+    return systems_n;
+}
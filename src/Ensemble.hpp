@@ -0,0 +1,58 @@
+#ifndef _Ensemble_h
+#define _Ensemble_h
+#include "Body.hpp"
+#include <stdio.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// How many independent systems are advanced side by side in one batch. Each
+// system is a SIMD lane, so this should be a multiple of the vector width
+const size_t ENSEMBLE_LANES = 8;
+
+// One line of an ensemble manifest
+struct EnsembleSystem {
+    std::string input_filename;
+    std::string output_filename;
+    unsigned int num_time_steps;
+    unsigned int output_interval;
+    double delta_t;
+    unsigned int bodies_n;
+};
+
+// Up to ENSEMBLE_LANES systems with the same number of bodies, steps and
+// output interval, stored body-major and lane-minor: the state of body i in
+// lane l lives at [i * ENSEMBLE_LANES + l]. Every loop over lanes is then a
+// unit stride loop with no dependencies between iterations
+class EnsembleBatch {
+    public:
+        // Constructors
+        EnsembleBatch(const std::vector<EnsembleSystem>& systems);
+        // Fields
+        std::vector<EnsembleSystem> systems;
+        unsigned int bodies_n;
+        std::vector<double> m;
+        std::vector<double> Gm;
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> vx;
+        std::vector<double> vy;
+        std::vector<double> Fx;
+        std::vector<double> Fy;
+        double dt[ENSEMBLE_LANES];
+        // whether each of systems parsed. The ones that didn't are padding
+        bool loaded[ENSEMBLE_LANES];
+        // Methods
+        size_t load();
+        void calculate_forces();
+        void step();
+        void total_energy(double energy[ENSEMBLE_LANES]) const;
+        void dump_timestep(double timestamps[ENSEMBLE_LANES], FILE *outputs[ENSEMBLE_LANES]) const;
+        size_t run();
+};
+
+std::vector<EnsembleSystem> parse_manifest(std::ifstream& manifest_fh);
+std::vector<EnsembleBatch> make_batches(std::vector<EnsembleSystem> systems);
+size_t run_ensemble(const std::string& manifest_filename, int rank, int size);
+
+#endif
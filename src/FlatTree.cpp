@@ -0,0 +1,211 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "FlatTree.hpp"
+#include "QuadTree.hpp"
+#include "Body.hpp"
+#include "Tile.hpp"
+#include "utils.hpp"
+
+const double THETA = 0.5;
+
+FlatTree::FlatTree(const QuadTree& root) {
+    flatten(root);
+}
+
+void FlatTree::flatten(const QuadTree& node) {
+    // empty external node
+    if (node.occupant == nullptr && node.nw == nullptr) {
+        return;
+    }
+
+    const size_t index = nodes.size();
+
+    FlatNode flat;
+    flat.x = node.x;
+    flat.y = node.y;
+    flat.s = node.radius * 2; // need width
+    flat.mx = node.mx;
+    flat.my = node.my;
+    flat.m = node.m;
+    flat.bodies_first = leaf_bodies.size();
+    flat.bodies_n = 0;
+
+    if (node.nw == nullptr) {
+        // occupied external node, and any bucket it has at MAX_DEPTH
+        leaf_bodies.push_back(node.occupant);
+        leaf_bodies.insert(leaf_bodies.end(), node.bucket.begin(), node.bucket.end());
+
+        flat.bodies_n = leaf_bodies.size() - flat.bodies_first;
+    }
+
+    nodes.push_back(flat);
+
+    if (node.nw != nullptr) {
+        flatten(*node.nw);
+        flatten(*node.ne);
+        flatten(*node.sw);
+        flatten(*node.se);
+    }
+
+    nodes[index].skip = nodes.size();
+    nodes[index].subtree_last = leaf_bodies.size();
+}
+
+/*  To calculate the net force acting on body b, walk the nodes in order,
+    starting with the root of the quad-tree:
+
+    1.  If the current node is an external node (and it is not body b), 
+        calculate the force exerted by the current node on b, 
+        and add this amount to b’s net force. Move on to the next node.
+
+    2.  Otherwise, calculate the ratio s/d. 
+
+        s is the width of the region represented by the internal node, and
+        d is the distance between the body and the node's center
+    
+        If s/d < θ, (the internal node is sufficiently far away) 
+        treat this internal node as a single body, 
+        and calculate the force it exerts on body b, 
+        and add this amount to b’s net force.
+        Skip over the node's children.
+
+    3. Otherwise, move on to the next node, which is the first of its children.
+
+    NB: Note that if θ = 0, then no internal node is treated as a single body, 
+        and the algorithm degenerates to brute force.
+*/
+void FlatTree::calculate_force(Body& body) const {
+    const FlatNode *flat = nodes.data();
+    const size_t nodes_n = nodes.size();
+
+    size_t i = 0;
+
+    while (i < nodes_n) {
+        const FlatNode& node = flat[i];
+
+        // Case 1 - external node
+        if (node.bodies_n > 0) {
+            for (size_t k = node.bodies_first; k < node.bodies_first + node.bodies_n; k++) {
+                const Body *there = leaf_bodies[k];
+
+                if (there != &body) {
+                    body.exert_force_unidirectionally(*there);
+                }
+            }
+
+            i = node.skip;
+            continue;
+        }
+
+        // Case 2 - internal node
+        const double d = distance(body.x, body.y, node.x, node.y);
+
+        if (node.s / d < THETA) {
+            Body pseudobody = Body();
+            pseudobody.x = node.mx;
+            pseudobody.y = node.my;
+            pseudobody.m = node.m;
+
+            body.exert_force_unidirectionally(pseudobody);
+
+            i = node.skip;
+        } else {
+            // Case 3 - open it
+            i++;
+        }
+    }
+}
+
+/*  Splits the tree into groups of nearby bodies: the largest subtrees with
+    at most GROUP_SIZE bodies, plus any bucket at MAX_DEPTH that alone holds
+    more. Every body is in exactly one group. Returns their node indices
+*/
+std::vector<unsigned int> FlatTree::groups() const {
+    std::vector<unsigned int> group_nodes = {};
+    const size_t nodes_n = nodes.size();
+
+    size_t i = 0;
+
+    while (i < nodes_n) {
+        const FlatNode& node = nodes[i];
+
+        if (node.subtree_last - node.bodies_first <= GROUP_SIZE || node.bodies_n > 0) {
+            group_nodes.push_back(i);
+            i = node.skip;
+        } else {
+            i++;
+        }
+    }
+
+    return group_nodes;
+}
+
+/*  The same walk as calculate_force, but for a whole group of bodies at once,
+    and rather than exerting each force as we go, we append every accepted
+    node to one interaction list that every body in the group then shares.
+    The list uses the centre of the group as its origin, so it can be
+    evaluated in float SIMD lanes by Tile::exert_force.
+
+    A node is only accepted if s/d < θ holds for the nearest point of the
+    group's bounding box, and so for every body in the group. The group's own
+    bodies are in the list too, and each one sees itself at Δ = 0, which
+    Tile::exert_force already skips.
+*/
+void FlatTree::collect_group_interactions(unsigned int group, Tile& interactions) const {
+    const FlatNode& group_node = nodes[group];
+
+    double min_x = leaf_bodies[group_node.bodies_first]->x;
+    double max_x = min_x;
+    double min_y = leaf_bodies[group_node.bodies_first]->y;
+    double max_y = min_y;
+
+    for (size_t k = group_node.bodies_first; k < group_node.subtree_last; k++) {
+        min_x = std::min(min_x, leaf_bodies[k]->x);
+        max_x = std::max(max_x, leaf_bodies[k]->x);
+        min_y = std::min(min_y, leaf_bodies[k]->y);
+        max_y = std::max(max_y, leaf_bodies[k]->y);
+    }
+
+    const double centre_x = (min_x + max_x) / 2;
+    const double centre_y = (min_y + max_y) / 2;
+    const double half_width = (max_x - min_x) / 2;
+    const double half_height = (max_y - min_y) / 2;
+
+    interactions.reset(centre_x, centre_y);
+
+    const FlatNode *flat = nodes.data();
+    const size_t nodes_n = nodes.size();
+
+    size_t i = 0;
+
+    while (i < nodes_n) {
+        const FlatNode& node = flat[i];
+
+        if (node.bodies_n > 0) {
+            for (size_t k = node.bodies_first; k < node.bodies_first + node.bodies_n; k++) {
+                const Body *there = leaf_bodies[k];
+
+                interactions.push_back(there->x, there->y, there->m);
+            }
+
+            i = node.skip;
+            continue;
+        }
+
+        // the distance from the node's centre to the nearest point of the
+        // group's bounding box. 0 (so open it) if the centre is inside
+        const double d_x = std::max(0.0, std::fabs(node.x - centre_x) - half_width);
+        const double d_y = std::max(0.0, std::fabs(node.y - centre_y) - half_height);
+        const double d = std::sqrt((d_x * d_x) + (d_y * d_y));
+
+        if (node.s < THETA * d) {
+            interactions.push_back(node.mx, node.my, node.m);
+
+            i = node.skip;
+        } else {
+            i++;
+        }
+    }
+}
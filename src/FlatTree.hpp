@@ -0,0 +1,55 @@
+#ifndef _FlatTree_h
+#define _FlatTree_h
+#include "Body.hpp"
+#include "QuadTree.hpp"
+#include "Tile.hpp"
+#include <vector>
+#include <cstddef>
+
+// One QuadTree node, as an entry in a FlatTree
+struct FlatNode {
+    // centre and width of the region
+    double x;
+    double y;
+    double s;
+    // centre of mass and total mass
+    double mx;
+    double my;
+    double m;
+    // the entry after this node's whole subtree. For a leaf that's just the
+    // next entry
+    unsigned int skip;
+    // a leaf's bodies are FlatTree::leaf_bodies[bodies_first, + bodies_n).
+    // Internal nodes have none
+    unsigned int bodies_first;
+    unsigned int bodies_n;
+    // every body anywhere in the subtree, since depth-first order keeps them
+    // together: leaf_bodies[bodies_first, subtree_last)
+    unsigned int subtree_last;
+};
+
+// The most bodies that share one interaction list, see
+// FlatTree::collect_group_interactions
+const size_t GROUP_SIZE = 32;
+
+// A QuadTree linearised into depth-first order (nw, ne, sw, se, as the tree
+// was always walked). Opening a node means moving on to the next entry, and
+// accepting it means jumping to its skip index, so a force walk is a single
+// forward loop over one array, with no recursion and no stack.
+//
+// Empty leaves are dropped, since they never contribute anything
+class FlatTree {
+    public:
+        // Constructors
+        FlatTree(const QuadTree& root);
+        // Fields
+        std::vector<FlatNode> nodes;
+        std::vector<Body*> leaf_bodies;
+        // Methods
+        void flatten(const QuadTree& node);
+        void calculate_force(Body& body) const;
+        std::vector<unsigned int> groups() const;
+        void collect_group_interactions(unsigned int group, Tile& interactions) const;
+};
+
+#endif
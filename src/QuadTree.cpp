@@ -9,15 +9,14 @@
 #include "Body.hpp"
 #include "utils.hpp"
 
-const double THETA = 0.5;
-
 QuadTree::QuadTree() {
 }
 
-QuadTree::QuadTree(double x, double y, double radius): 
+QuadTree::QuadTree(double x, double y, double radius, unsigned int depth): 
     x(x),
     y(y),
     radius(radius),
+    depth(depth),
     mx(0),
     my(0),
     m(1),
@@ -46,76 +45,10 @@ void QuadTree::subdivide() {
     const double r = radius / 2;
 
     // (x, y, radius)
-    ne = std::make_shared<QuadTree>(x + r, y + r, r);
-    nw = std::make_shared<QuadTree>(x - r, y + r, r);
-    se = std::make_shared<QuadTree>(x + r, y - r, r);
-    sw = std::make_shared<QuadTree>(x - r, y - r, r);
-}
-
-/*  To calculate the net force acting on body b, use the following recursive procedure, 
-    starting with the root of the quad-tree:
-
-    1.  If the current node is an external node (and it is not body b), 
-        calculate the force exerted by the current node on b, 
-        and add this amount to b’s net force.
-
-    2.  Otherwise, calculate the ratio s/d. 
-
-        s is the width of the region represented by the internal node, and
-        d is the distance between the body and the node's center-of-mass
-    
-        If s/d < θ, (the internal node is sufficiently far away) 
-        treat this internal node as a single body, 
-        and calculate the force it exerts on body b, 
-        and add this amount to b’s net force.
-
-    3. Otherwise, run the procedure recursively on each of the current node’s children.
-
-    NB: Note that if θ = 0, then no internal node is treated as a single body, 
-        and the algorithm degenerates to brute force.
-*/
-void QuadTree::calculate_force(Body& body) {
-    // Case 1 - empty external node
-    if (occupant == nullptr && nw == nullptr) { 
-        return;
-    }
-
-    // Case 2 - occupied external node
-    if (nw == nullptr) {
-        if (occupant == &body) {
-            return;
-        } else {
-            auto& there = *occupant;
-        
-            body.exert_force_unidirectionally(there);
-
-            return;
-        }
-    }
-
-    // Case 3 - internal node
-    assert(occupant == nullptr && nw != nullptr);
-
-    const double s = radius * 2; // need width
-    const double d = distance(body.x, body.y, x, y);
-
-    if (s / d < THETA) {
-        Body pseudobody = Body();
-        pseudobody.x = mx;
-        pseudobody.y = my;
-        pseudobody.m = m;
-
-        body.exert_force_unidirectionally(pseudobody);
-        return;
-
-    } else {
-        nw->calculate_force(body);
-        ne->calculate_force(body);
-        sw->calculate_force(body);
-        se->calculate_force(body);
-
-        return;
-    }
+    ne = std::make_shared<QuadTree>(x + r, y + r, r, depth + 1);
+    nw = std::make_shared<QuadTree>(x - r, y + r, r, depth + 1);
+    se = std::make_shared<QuadTree>(x + r, y - r, r, depth + 1);
+    sw = std::make_shared<QuadTree>(x - r, y - r, r, depth + 1);
 }
 
 /*  To construct the Barnes-Hut tree, insert the bodies one after another.
@@ -133,8 +66,12 @@ void QuadTree::calculate_force(Body& body) {
         Since b and c may still end up in the same quadrant, 
         there may be several subdivisions during a single insertion.
         Finally, update the center-of-mass and total mass of x.
+
+    4.  If node x is an external node at MAX_DEPTH, it is never subdivided.
+        b joins c in the node's bucket instead, and the bucket is treated as
+        a set of bodies (not a single pseudobody) when forces are calculated.
 */
-bool QuadTree::insert_all(std::vector<Body>& bodies) {
+bool QuadTree::insert_all(Bodies& bodies) {
     for (auto& body : bodies) {
         const bool did_insert = insert(body);
         if (!did_insert)
@@ -175,6 +112,13 @@ bool QuadTree::insert(Body& body) {
         return true;
     }
 
+    // Case 4 - occupied external node that may not subdivide any further
+    if (nw == nullptr && depth >= MAX_DEPTH) {
+        bucket.push_back(&body);
+
+        return true;
+    }
+
     Body *displaced = nullptr;
 
     // Case 2 - occupied external node
@@ -190,12 +134,12 @@ bool QuadTree::insert(Body& body) {
     // Cases 2 and 3 - newly subdivided external node and internal node
     assert(occupant == nullptr);
 
-    // These inserts should never fail. If they do, it's because
-    // - our root tree node has too small a radius, causing everything
-    //   downstream to be OOB
-    // - two bodies are directly ontop of each other, causing the tree to
-    //   infinitely subdivide
-    // - nasal demons
+    // These inserts only fail if the body isn't in any quadrant, i.e. it
+    // never belonged in this node. That happens when the root is too small
+    // for it or its position isn't finite. Either way the tree is unusable,
+    // so it's reported to the caller rather than asserted on
+    // Two bodies directly ontop of each other used to be on this list, but
+    // now they just end up sharing a bucket at MAX_DEPTH
     if (displaced) {
         const bool displaced_insertion_success = 
                nw->insert(*displaced) 
@@ -203,7 +147,9 @@ bool QuadTree::insert(Body& body) {
             || sw->insert(*displaced)
             || se->insert(*displaced);
 
-        assert(displaced_insertion_success);
+        if (!displaced_insertion_success) {
+            return false;
+        }
     }
 
     const bool new_insertion_success = 
@@ -212,7 +158,5 @@ bool QuadTree::insert(Body& body) {
         || sw->insert(body)
         || se->insert(body);
 
-    assert(new_insertion_success);
-
-    return true;
+    return new_insertion_success;
 }
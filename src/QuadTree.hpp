@@ -1,17 +1,25 @@
 #ifndef _QuadTree_h
 #define _QuadTree_h
 #include "Body.hpp"
+#include "Bodies.hpp"
 #include <memory>
+#include <vector>
+
+// Past this depth a leaf stops subdividing and keeps every body that lands in
+// it in a bucket. Coincident or very close bodies would otherwise subdivide
+// (nearly) forever
+const unsigned int MAX_DEPTH = 24;
 
 class QuadTree {
     public:
         // Constructors
         QuadTree();
-        QuadTree(double x, double y, double radius);
+        QuadTree(double x, double y, double radius, unsigned int depth = 0);
         // Fields
         double x;
         double y;
         double radius;
+        unsigned int depth;
         double mx;
         double my;
         double m;
@@ -20,11 +28,12 @@ class QuadTree {
         std::shared_ptr<QuadTree> se;
         std::shared_ptr<QuadTree> sw;
         Body *occupant;
+        // Bodies sharing a leaf at MAX_DEPTH with occupant
+        std::vector<Body*> bucket;
         // Methods
         bool insert(Body& body);
-        bool insert_all(std::vector<Body>& bodies);
+        bool insert_all(Bodies& bodies);
         bool within_bounds(const Body& body) const;
         void subdivide();
-        void calculate_force(Body& body);
 };
 #endif
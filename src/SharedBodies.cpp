@@ -0,0 +1,135 @@
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+
+#include "SharedBodies.hpp"
+#include "Bodies.hpp"
+#include "Body.hpp"
+
+SharedBodies::SharedBodies(size_t n, MPI_Comm comm, MPI_Datatype body_type):
+    Bodies(nullptr, n),
+    comm(comm),
+    node_comm(MPI_COMM_NULL),
+    leader_comm(MPI_COMM_NULL),
+    body_type(body_type),
+    window(MPI_WIN_NULL),
+    node_rank(0),
+    nodes_n(0) {
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Every rank that can share memory with us. Keyed on rank, so the root
+    // of comm is always the leader of its node
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+
+    int node_size;
+    MPI_Comm_size(node_comm, &node_size);
+
+    const bool leader = node_rank == 0;
+    MPI_Comm_split(comm, leader ? 0 : MPI_UNDEFINED, rank, &leader_comm);
+
+    // Only the leader backs the window with memory, everyone else maps it
+    const MPI_Aint window_size = leader ? n * sizeof(Body) : 0;
+    Body *base = nullptr;
+
+    MPI_Win_allocate_shared(window_size, sizeof(Body), MPI_INFO_NULL, node_comm, &base, &window);
+
+    MPI_Aint leader_size;
+    int displacement_unit;
+    MPI_Win_shared_query(window, 0, &leader_size, &displacement_unit, &data);
+
+    // One passive epoch for the life of the window. Ordering between ranks
+    // comes from MPI_Win_sync and node barriers, see exchange
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+    // Which node we are, and how many there are, is only known to leaders
+    int node = 0;
+
+    if (leader) {
+        MPI_Comm_rank(leader_comm, &node);
+        MPI_Comm_size(leader_comm, &nodes_n);
+    }
+
+    MPI_Bcast(&node, 1, MPI_INT, 0, node_comm);
+    MPI_Bcast(&nodes_n, 1, MPI_INT, 0, node_comm);
+
+    for (int k = 0; k < nodes_n; k++) {
+        const size_t node_first = (n * k) / nodes_n;
+        const size_t node_last = (n * (k + 1)) / nodes_n;
+
+        node_displacements.push_back(node_first);
+        node_counts.push_back(node_last - node_first);
+    }
+
+    const size_t node_first = node_displacements[node];
+    const size_t node_n = node_counts[node];
+
+    first = node_first + (node_n * node_rank) / node_size;
+    last = node_first + (node_n * (node_rank + 1)) / node_size;
+}
+
+SharedBodies::~SharedBodies() {
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&leader_comm);
+    }
+
+    MPI_Comm_free(&node_comm);
+}
+
+// Copies bodies, which only needs to be populated on rank 0 of comm, into
+// every node's window. Only one copy crosses the network per node
+void SharedBodies::distribute(const std::vector<Body>& bodies) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    if (rank == 0) {
+        std::copy(bodies.begin(), bodies.end(), data);
+    }
+
+    if (leader_comm != MPI_COMM_NULL) {
+        // rank 0 of comm is also rank 0 of leader_comm, see the constructor
+        MPI_Bcast(data, n, body_type, 0, leader_comm);
+    }
+
+    barrier();
+}
+
+void SharedBodies::exchange() {
+    // Everyone on this node has finished writing their share
+    barrier();
+
+    if (leader_comm != MPI_COMM_NULL && nodes_n > 1) {
+        MPI_Allgatherv(
+            MPI_IN_PLACE, // sendbuf, our share is already in place
+            0,
+            MPI_DATATYPE_NULL,
+            data, // recvbuf
+            node_counts.data(),
+            node_displacements.data(),
+            body_type,
+            leader_comm
+        );
+    }
+
+    // and now every node's share is in the window
+    barrier();
+}
+
+void SharedBodies::barrier() {
+    MPI_Win_sync(window);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(window);
+}
+
+void SharedBodies::reduce_sum(double *values, size_t values_n) {
+    MPI_Allreduce(MPI_IN_PLACE, values, values_n, MPI_DOUBLE, MPI_SUM, comm);
+}
+
+void SharedBodies::reduce_max(double *values, size_t values_n) {
+    MPI_Allreduce(MPI_IN_PLACE, values, values_n, MPI_DOUBLE, MPI_MAX, comm);
+}
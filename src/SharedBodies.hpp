@@ -0,0 +1,39 @@
+#ifndef _SharedBodies_h
+#define _SharedBodies_h
+#include "Bodies.hpp"
+#include "Body.hpp"
+#include <vector>
+#include <mpi.h>
+
+// The global body array, held once per node in an MPI-3 shared memory window
+// rather than once per rank.
+//
+// The bodies are split evenly between nodes, and each node's share is split
+// evenly between its ranks. Ranks on a node read and write the window
+// directly, and only the node leaders (node rank 0) talk to other nodes, by
+// exchanging their node's share
+class SharedBodies : public Bodies {
+    public:
+        // Constructors
+        SharedBodies(size_t n, MPI_Comm comm, MPI_Datatype body_type);
+        ~SharedBodies();
+        // Fields
+        MPI_Comm comm;
+        MPI_Comm node_comm;
+        MPI_Comm leader_comm;
+        MPI_Datatype body_type;
+        MPI_Win window;
+        int node_rank;
+        int nodes_n;
+        // Per node, in leader_comm rank order
+        std::vector<int> node_counts;
+        std::vector<int> node_displacements;
+        // Methods
+        void distribute(const std::vector<Body>& bodies);
+        void exchange() override;
+        void barrier() override;
+        void reduce_sum(double *values, size_t values_n) override;
+        void reduce_max(double *values, size_t values_n) override;
+};
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef _Simulation_h
+#define _Simulation_h
+#include <vector>
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+#include <cmath>
+
+#include "Body.hpp"
+#include "Bodies.hpp"
+#include "QuadTree.hpp"
+#include "FlatTree.hpp"
+#include "Tile.hpp"
+#include "utils.hpp"
+
+// The simulation core is assembled from three policies, chosen once at startup
+// rather than tested with an `if` for every body on every step:
+//
+//   Integrator::step<ForceEngine, Precision>(bodies, dt)
+//     -> ForceEngine::calculate_forces<Precision>(bodies)
+//       -> Precision::direct_sum / Precision::tree_walk
+//
+// Everything here is a template, so each combination is compiled (and
+// inlined) separately, with none of the other combinations' branches in it.
+//
+// Forces are only calculated for, and integration only applied to, the bodies
+// this process owns, [bodies.first, bodies.last). Every body may be read
+
+// ---------------------------------------------------------------------------//
+// Precision policies
+
+struct DoublePrecision {
+    static void direct_sum(Bodies& bodies) {
+        #pragma omp parallel for shared(bodies)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            auto& x = bodies[i];
+
+            // Are we doing twice the work here by not doing all
+            // pairwise combinations and exerting force
+            // bidirectionally?
+            // Yes!
+            // Does doing it this way eliminate locking?
+            // Also yes!
+            // And does it provide a massive parallel speedup?
+            // Damn straight it does
+            for (size_t j = 0; j < bodies.size(); j++) {
+                auto& y = bodies[j];
+
+                if (&bodies[i] != &bodies[j]) {
+                    // XXX: Do NOT swap these around. You will cause
+                    // race conditions
+                    x.exert_force_unidirectionally(y);
+                }
+            }
+        }
+    }
+
+    static void tree_walk(const FlatTree& tree, Bodies& bodies) {
+        #pragma omp parallel for shared(bodies, tree)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            tree.calculate_force(bodies[i]);
+        }
+    }
+};
+
+// float32 interactions, double accumulation. See Tile
+struct MixedPrecision {
+    static void direct_sum(Bodies& bodies) {
+        const std::vector<Tile> tiles = make_tiles(bodies);
+
+        #pragma omp parallel for shared(bodies)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            auto& x = bodies[i];
+
+            // Each tile skips x itself, since it sits at r = 0
+            for (const auto& tile : tiles) {
+                tile.exert_force(x);
+            }
+        }
+    }
+
+    // Building an interaction list (walking the tree, and converting every
+    // accepted node to float) costs about as much as evaluating it. So rather
+    // than one list per body, each group of nearby bodies shares one, see
+    // FlatTree::collect_group_interactions
+    static void tree_walk(const FlatTree& tree, Bodies& bodies) {
+        const std::vector<unsigned int> groups = tree.groups();
+        const Body *owned_first = bodies.data + bodies.first;
+        const Body *owned_last = bodies.data + bodies.last;
+
+        #pragma omp parallel shared(bodies, tree, groups)
+        {
+            // one interaction list per thread, so its storage gets reused
+            // from group to group
+            Tile interactions;
+
+            #pragma omp for schedule(dynamic)
+            for (size_t g = 0; g < groups.size(); g++) {
+                const FlatNode& group = tree.nodes[groups[g]];
+                bool owns_any = false;
+
+                for (size_t k = group.bodies_first; k < group.subtree_last; k++) {
+                    const Body *body = tree.leaf_bodies[k];
+                    owns_any = owns_any || (owned_first <= body && body < owned_last);
+                }
+
+                // another process has every one of these
+                if (!owns_any) {
+                    continue;
+                }
+
+                tree.collect_group_interactions(groups[g], interactions);
+
+                for (size_t k = group.bodies_first; k < group.subtree_last; k++) {
+                    Body *body = tree.leaf_bodies[k];
+
+                    if (owned_first <= body && body < owned_last) {
+                        interactions.exert_force(*body);
+                    }
+                }
+            }
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------//
+// Force engines
+
+struct DirectSum {
+    template <class Precision>
+    static void calculate_forces(Bodies& bodies) {
+        #pragma omp parallel for shared(bodies)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            bodies[i].reset_force();
+        }
+
+        Precision::direct_sum(bodies);
+    }
+};
+
+struct BarnesHut {
+    template <class Precision>
+    static void calculate_forces(Bodies& bodies) {
+        const double root_x = 0;
+        const double root_y = 0;
+        // the quad-tree uses half the width as an implementation detail
+        // called "radius". We're trying to make a QuadTree that encapsulates
+        // the most distant body
+        // Each process builds the whole tree, since any body can be near one
+        // of ours
+        const double deviation = maximum_deviation_from_root(bodies);
+
+        // The smallest power of two strictly above the deviation. Every cell's
+        // centre and radius are then exact in a double, so the children tile
+        // their parent exactly, and the outermost body can't round onto the
+        // root's exclusive upper bound however far out it is (a "+ 1" pad is
+        // lost past 2^53)
+        int exponent = 0;
+        std::frexp(deviation, &exponent);
+        const double radius = std::ldexp(1.0, exponent);
+
+        QuadTree qroot = QuadTree(root_x, root_y, radius);
+
+        // Only a body with a non-finite position can't be placed. There's no
+        // tree for that, so this step falls back to the direct sum
+        if (!std::isfinite(deviation) || !qroot.insert_all(bodies)) {
+            static bool warned = false;
+
+            if (!warned) {
+                fprintf(stderr, "Barnes-Hut: a body can't be placed in the tree, using the direct sum\n");
+                warned = true;
+            }
+
+            DirectSum::calculate_forces<Precision>(bodies);
+            return;
+        }
+
+        // the walks all go over the linearised copy, see FlatTree
+        const FlatTree tree(qroot);
+
+        #pragma omp parallel for shared(bodies)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            bodies[i].reset_force();
+        }
+
+        Precision::tree_walk(tree, bodies);
+    }
+};
+
+// ---------------------------------------------------------------------------//
+// Integrators
+
+// One drift of the bodies we own by drift_dt, then the forces at the new
+// positions, then one kick by kick_dt. Every integrator below is built out of
+// these, so they all share the same force engines and synchronisation
+template <class ForceEngine, class Precision>
+void drift_kick(Bodies& bodies, double drift_dt, double kick_dt) {
+    #pragma omp parallel for shared(bodies)
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        bodies[i].leap(drift_dt);
+    }
+
+    // forces need everyone's new positions
+    bodies.exchange();
+
+    ForceEngine::template calculate_forces<Precision>(bodies);
+
+    // and nobody may move again until everyone's done reading them.
+    // frog only writes velocities, which forces don't read
+    bodies.barrier();
+
+    #pragma omp parallel for shared(bodies)
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        bodies[i].frog(kick_dt);
+    }
+}
+
+inline void drift(Bodies& bodies, double dt) {
+    #pragma omp parallel for shared(bodies)
+    for (size_t i = bodies.first; i < bodies.last; i++) {
+        bodies[i].leap(dt);
+    }
+}
+
+// Body::leap, then the forces at the new positions, then Body::frog.
+// First order, one force evaluation per step
+struct LeapFrog {
+    static const unsigned int FORCE_EVALUATIONS = 1;
+
+    template <class ForceEngine, class Precision>
+    static void step(Bodies& bodies, double dt) {
+        drift_kick<ForceEngine, Precision>(bodies, dt, dt);
+    }
+};
+
+struct Euler {
+    static const unsigned int FORCE_EVALUATIONS = 1;
+
+    template <class ForceEngine, class Precision>
+    static void step(Bodies& bodies, double dt) {
+        ForceEngine::template calculate_forces<Precision>(bodies);
+
+        bodies.barrier();
+
+        #pragma omp parallel for shared(bodies)
+        for (size_t i = bodies.first; i < bodies.last; i++) {
+            bodies[i].euler_integrate(dt);
+        }
+
+        bodies.exchange();
+    }
+};
+
+// Yoshida's fourth order "triple jump", in the position (drift first) form
+// that Forest and Ruth published. Three force evaluations per step
+struct Yoshida4 {
+    static const unsigned int FORCE_EVALUATIONS = 3;
+
+    template <class ForceEngine, class Precision>
+    static void step(Bodies& bodies, double dt) {
+        // w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1
+        const double w1 = 1.3512071919596578;
+        const double w0 = -1.7024143839193155;
+
+        drift_kick<ForceEngine, Precision>(bodies, (w1 / 2) * dt, w1 * dt);
+        drift_kick<ForceEngine, Precision>(bodies, ((w0 + w1) / 2) * dt, w0 * dt);
+        drift_kick<ForceEngine, Precision>(bodies, ((w0 + w1) / 2) * dt, w1 * dt);
+        drift(bodies, (w1 / 2) * dt);
+    }
+};
+
+// Omelyan, Mryglod and Folk's position extended Forest-Ruth like scheme.
+// Still fourth order, with an extra force evaluation per step (four), but an
+// error constant around a hundred times smaller than Yoshida4's
+struct PEFRL {
+    static const unsigned int FORCE_EVALUATIONS = 4;
+
+    template <class ForceEngine, class Precision>
+    static void step(Bodies& bodies, double dt) {
+        const double xi = 0.1786178958448091;
+        const double lambda = -0.2123418310626054;
+        const double chi = -0.06626458266981849;
+
+        drift_kick<ForceEngine, Precision>(bodies, xi * dt, ((1 - 2 * lambda) / 2) * dt);
+        drift_kick<ForceEngine, Precision>(bodies, chi * dt, lambda * dt);
+        drift_kick<ForceEngine, Precision>(bodies, (1 - 2 * (chi + xi)) * dt, lambda * dt);
+        drift_kick<ForceEngine, Precision>(bodies, chi * dt, ((1 - 2 * lambda) / 2) * dt);
+        drift(bodies, xi * dt);
+    }
+};
+
+enum IntegratorKind {
+    INTEGRATOR_LEAPFROG,
+    INTEGRATOR_EULER,
+    INTEGRATOR_YOSHIDA4,
+    INTEGRATOR_PEFRL
+};
+
+// Returns false for a name we don't know
+inline bool parse_integrator(const std::string& name, IntegratorKind& integrator) {
+    if (name == "leapfrog") {
+        integrator = INTEGRATOR_LEAPFROG;
+    } else if (name == "euler") {
+        integrator = INTEGRATOR_EULER;
+    } else if (name == "yoshida4" || name == "forestruth") {
+        integrator = INTEGRATOR_YOSHIDA4;
+    } else if (name == "pefrl") {
+        integrator = INTEGRATOR_PEFRL;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------//
+// Choosing policies
+
+// One full step of whichever combination of policies was chosen
+typedef void (*Stepper)(Bodies&, double);
+
+// Calls Chooser::choose<ForceEngine, Integrator, Precision>() for the one
+// combination the runtime flags ask for. Chooser decides what to instantiate
+// with it; StepperChooser below is the simplest such Chooser
+template <class Chooser, class ForceEngine, class Integrator>
+typename Chooser::result_type choose_policies(bool enable_mixed_precision) {
+    return enable_mixed_precision
+        ? Chooser::template choose<ForceEngine, Integrator, MixedPrecision>()
+        : Chooser::template choose<ForceEngine, Integrator, DoublePrecision>();
+}
+
+template <class Chooser, class ForceEngine>
+typename Chooser::result_type choose_policies(IntegratorKind integrator, bool enable_mixed_precision) {
+    switch (integrator) {
+        case INTEGRATOR_EULER:
+            return choose_policies<Chooser, ForceEngine, Euler>(enable_mixed_precision);
+        case INTEGRATOR_YOSHIDA4:
+            return choose_policies<Chooser, ForceEngine, Yoshida4>(enable_mixed_precision);
+        case INTEGRATOR_PEFRL:
+            return choose_policies<Chooser, ForceEngine, PEFRL>(enable_mixed_precision);
+        case INTEGRATOR_LEAPFROG:
+        default:
+            return choose_policies<Chooser, ForceEngine, LeapFrog>(enable_mixed_precision);
+    }
+}
+
+template <class Chooser>
+typename Chooser::result_type choose_policies(
+    bool enable_barnes_hut,
+    IntegratorKind integrator,
+    bool enable_mixed_precision
+) {
+    return enable_barnes_hut
+        ? choose_policies<Chooser, BarnesHut>(integrator, enable_mixed_precision)
+        : choose_policies<Chooser, DirectSum>(integrator, enable_mixed_precision);
+}
+
+struct StepperChooser {
+    typedef Stepper result_type;
+
+    template <class ForceEngine, class Integrator, class Precision>
+    static Stepper choose() {
+        return &Integrator::template step<ForceEngine, Precision>;
+    }
+};
+
+// How many times one step of the chosen integrator evaluates the forces
+struct ForceEvaluationsChooser {
+    typedef unsigned int result_type;
+
+    template <class ForceEngine, class Integrator, class Precision>
+    static unsigned int choose() {
+        return Integrator::FORCE_EVALUATIONS;
+    }
+};
+
+#endif
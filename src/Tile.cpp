@@ -0,0 +1,99 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "Tile.hpp"
+#include "Body.hpp"
+
+Tile::Tile():
+    origin_x(0),
+    origin_y(0) {
+}
+
+void Tile::reset(double new_origin_x, double new_origin_y) {
+    origin_x = new_origin_x;
+    origin_y = new_origin_y;
+
+    x.clear();
+    y.clear();
+    m.clear();
+}
+
+void Tile::push_back(double there_x, double there_y, double there_m) {
+    // The subtraction happens in double, so a body far from the origin of the
+    // simulation keeps all of its significant bits once it's in the tile
+    x.push_back(static_cast<float>(there_x - origin_x));
+    y.push_back(static_cast<float>(there_y - origin_y));
+    m.push_back(static_cast<float>(there_m));
+}
+
+void Tile::load(const Body *bodies, size_t n) {
+    // Use the centroid as the origin, which keeps the float offsets as small
+    // as the spread of the tile allows
+    double centroid_x = 0;
+    double centroid_y = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        centroid_x += bodies[i].x;
+        centroid_y += bodies[i].y;
+    }
+
+    reset(centroid_x / n, centroid_y / n);
+
+    for (size_t i = 0; i < n; i++) {
+        push_back(bodies[i].x, bodies[i].y, bodies[i].m);
+    }
+}
+
+size_t Tile::size() const {
+    return m.size();
+}
+
+void Tile::exert_force(Body& body) const {
+    // See Body::exert_force_unidirectionally for the double precision version
+    // of this kernel. We pull Gm out of the loop, and only the per-lane
+    // m2 / r^3 term is evaluated in float
+    const float here_x = static_cast<float>(body.x - origin_x);
+    const float here_y = static_cast<float>(body.y - origin_y);
+
+    const float *there_x = x.data();
+    const float *there_y = y.data();
+    const float *there_m = m.data();
+    const size_t n = size();
+    const float softening2 = static_cast<float>(Body::softening2);
+
+    double Fx = 0;
+    double Fy = 0;
+
+    #pragma omp simd reduction(+:Fx, Fy)
+    for (size_t j = 0; j < n; j++) {
+        const float delta_x = there_x[j] - here_x;
+        const float delta_y = there_y[j] - here_y;
+
+        const float r2 = (delta_x * delta_x) + (delta_y * delta_y) + softening2;
+
+        // A body sees itself at Δ = 0, and exerts no force on itself. This
+        // is a select rather than a branch, so the loop still vectorises
+        const float scale_factor = r2 > 0 ? there_m[j] / (r2 * std::sqrt(r2)) : 0.0f;
+
+        Fx += static_cast<double>(delta_x * scale_factor);
+        Fy += static_cast<double>(delta_y * scale_factor);
+    }
+
+    body.Fx += body.Gm * Fx;
+    body.Fy += body.Gm * Fy;
+}
+
+std::vector<Tile> make_tiles(const Bodies& bodies) {
+    std::vector<Tile> tiles((bodies.size() + TILE_SIZE - 1) / TILE_SIZE);
+
+    #pragma omp parallel for
+    for (size_t t = 0; t < tiles.size(); t++) {
+        const size_t first = t * TILE_SIZE;
+        const size_t n = std::min(TILE_SIZE, bodies.size() - first);
+
+        tiles[t].load(&bodies[first], n);
+    }
+
+    return tiles;
+}
@@ -0,0 +1,34 @@
+#ifndef _Tile_h
+#define _Tile_h
+#include "Body.hpp"
+#include "Bodies.hpp"
+#include <vector>
+#include <cstddef>
+
+// How many bodies the direct-sum kernel packs into a single tile
+const size_t TILE_SIZE = 64;
+
+// A run of point masses stored as float32, relative to a double precision
+// origin, so that the interaction kernel can run in float SIMD lanes while
+// the forces are still accumulated in double
+class Tile {
+    public:
+        // Constructors
+        Tile();
+        // Fields
+        double origin_x;
+        double origin_y;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> m;
+        // Methods
+        void reset(double origin_x, double origin_y);
+        void push_back(double x, double y, double m);
+        void load(const Body *bodies, size_t n);
+        size_t size() const;
+        void exert_force(Body& body) const;
+};
+
+std::vector<Tile> make_tiles(const Bodies& bodies);
+
+#endif
@@ -9,88 +9,28 @@
 #include <omp.h>
 #include <mpi.h>
 #include <cmath>
+#include <cerrno>
+#include <cstdlib>
 
 #include "Body.hpp"
 #include "QuadTree.hpp"
+#include "Tile.hpp"
+#include "Ensemble.hpp"
+#include "Simulation.hpp"
+#include "Bodies.hpp"
+#include "SharedBodies.hpp"
+#include "Diagnostics.hpp"
 #include "utils.hpp"
 
 MPI_Datatype MPI_Body;
 
-const unsigned int LEAP = 0;
-const unsigned int FROG = 1;
-
-const bool ENABLE_LEAPFROG = true;
-const bool ENABLE_LOGGING = false;
-
 const int root = 0;
 
 double cpu_time(void) {
     return (double)clock() / (double)CLOCKS_PER_SEC;
 }
 
-double maximum_deviation_from_root(const std::vector<Body>& bodies) {
-    double lowest_x = std::numeric_limits<double>::max();
-    double highest_x = std::numeric_limits<double>::min();
-    double lowest_y = std::numeric_limits<double>::max();
-    double highest_y = std::numeric_limits<double>::min();
-
-    for (size_t i = 0; i < bodies.size(); i++) {
-        auto& body = bodies[i];
-
-        if (body.x < lowest_x) {
-            lowest_x = body.x;
-        }
-        else if (highest_x < body.x) {
-            highest_x = body.x;
-        }
-
-        if (body.y < lowest_y) {
-            lowest_y = body.y;
-        }
-        else if (highest_y < body.y) {
-            highest_y = body.y;
-        }
-    }
-
-    return std::max(highest_y - lowest_y, highest_x - lowest_x);
-}
-
-
-double calculate_kinetic_energy(const std::vector<Body>& bodies) {
-    double acc = 0;
-
-    #pragma omp parallel for reduction(+:acc)
-    for (size_t i = 0; i < bodies.size(); i++) {
-        auto& body = bodies[i];
-        acc += body.kinetic_energy();
-    }
-
-    return acc;
-}
-
-double calculate_gravitational_potential_energy(const std::vector<Body>& bodies) {
-    double acc = 0;
-
-    #pragma omp parallel for reduction(+:acc)
-    for (size_t i = 0; i < bodies.size() - 1; i++) {
-        auto& x = bodies[i];
-
-        for (size_t j = i + 1; j < bodies.size(); j++) {
-            auto& y = bodies[j];
-
-            acc += x.gravitational_potential_energy(y);
-        }
-    }
-    
-    return acc;
-}
-
-double calculate_total_energy(const std::vector<Body>& bodies) {
-    return calculate_gravitational_potential_energy(bodies) 
-        + calculate_kinetic_energy(bodies);
-}
-
-void dump_masses(const std::vector<Body>& bodies) {
+void dump_masses(const Bodies& bodies) {
     for (const auto& body: bodies) {
         fprintf(stdout, "%f\n", body.m);
     }
@@ -112,7 +52,7 @@ x1 y1 vx1 vy1
 ...
 xN yN vxN vyN
 */
-void dump_timestep(double timestamp, const std::vector<Body>& bodies) {
+void dump_timestep(double timestamp, const Bodies& bodies) {
     const double total_energy = calculate_total_energy(bodies);
 
     fprintf(stdout, "%f %f\n", timestamp, total_energy);
@@ -128,120 +68,124 @@ void dump_meta_info(
     unsigned int num_time_steps,
     unsigned int output_interval,
     double delta_t,
-    const std::vector<Body>& bodies
+    const Bodies& bodies
 ) {
     const unsigned int bodies_n = bodies.size();
 
     fprintf(stdout, "%d %d %d %f\n", bodies_n, num_time_steps, output_interval, delta_t); 
 }
 
-void scatter_bodies(const std::vector<Body>& bodies, std::vector<Body>& sbodies, int rank, 
-    const std::vector<int>& send_counts, const std::vector<int>& displacements) {
-
-    unsigned int receive_count = send_counts[rank];
-
-    MPI_Scatterv(
-        bodies.data(), // sendbuf
-        send_counts.data(), 
-        displacements.data(),
-        MPI_Body,  // sendtype
-        sbodies.data(), // recvbuf
-        receive_count,
-        MPI_Body, // recvtype
-        root, // rank of sending process
-        MPI_COMM_WORLD // communicator
-    );
-}
+// What simulate writes out, and how often. An interval of 0 means never
+struct OutputConfig {
+    // full snapshots of every body, to stdout
+    unsigned int output_interval;
+    // one Diagnostics record, to diagnostics_fh
+    unsigned int diagnostics_interval;
+    size_t radial_bins;
+    // the O(n^2) potential, on those diagnostics records whose step is also
+    // a multiple of this
+    unsigned int potential_interval;
+    // only open on the root
+    FILE *diagnostics_fh;
+};
+
+template <class ForceEngine, class Integrator, class Precision>
+void simulate(
+    Bodies& bodies,
+    unsigned int num_time_steps,
+    double timestep,
+    const OutputConfig& output,
+    int rank
+) {
+    double t = 0;
 
-void gather_bodies(std::vector<Body>& bodies, const std::vector<Body>& sbodies, int rank, 
-    const std::vector<int>& receive_counts, const std::vector<int>& displacements) {
-
-    unsigned int send_count = receive_counts[rank];
-
-    MPI_Gatherv(
-        sbodies.data(), // sendbuf
-        send_count,
-        MPI_Body,  // sendtype
-        bodies.data(), // recvbuf
-        receive_counts.data(),
-        displacements.data(),
-        MPI_Body,  // recvtype
-        root, // rank of sending process
-        MPI_COMM_WORLD // communicator
-    );
-}
+    Diagnostics diagnostics(output.radial_bins);
 
-/*
-numBodies
-Mass1
-Mass2
-...
-massN
-0.00 totalEnergy
-x1 y1 vx1 vy1
-..
-xN yN vxN vyN
-*/
-std::vector<Body> parse_input_file(std::ifstream& input_fh) {
-    // not a Body&; we want to maximise cache locality
-    std::vector<Body> bodies = {};
-    std::vector<double> masses = {};
-    std::string line;
-
-    unsigned int bodies_n = 0;
-
-    if (input_fh.is_open()) {
-        // numBodies
-        getline(input_fh, line);
-        sscanf(line.c_str(), "%u", &bodies_n);
-
-        while (getline(input_fh, line)) {
-            std::stringstream line_stream(line);
-            std::string segment;
-            std::vector<std::string> segs;
-
-            while (getline(line_stream, segment, ' ')) {
-                segs.push_back(segment);
-            }
+    if (output.diagnostics_interval != 0) {
+        diagnostics.measure(bodies, t, output.potential_interval != 0);
+
+        if (rank == root) {
+            diagnostics.write_header(output.diagnostics_fh);
+            diagnostics.write(output.diagnostics_fh);
+        }
+    }
+
+    for (unsigned int step = 1; step <= num_time_steps; step++) {
+        Integrator::template step<ForceEngine, Precision>(bodies, timestep);
+
+        t += timestep;
 
-            // a mass
-            if (segs.size() == 1) {
-                masses.push_back(std::stod(segs[0]));
-            } 
-            // a total energy description
-            else if (segs.size() == 2) { 
+        const bool need_snapshot = output.output_interval != 0
+            && step % output.output_interval == 0;
+        const bool need_diagnostics = output.diagnostics_interval != 0
+            && step % output.diagnostics_interval == 0;
+
+        if (need_snapshot || need_diagnostics) {
+            // the root needs everyone's latest velocities too, and nobody
+            // may move on while it's still reading them
+            bodies.exchange();
+
+            if (need_diagnostics) {
+                const bool need_potential = output.potential_interval != 0
+                    && step % output.potential_interval == 0;
+
+                diagnostics.measure(bodies, t, need_potential);
+
+                if (rank == root) {
+                    diagnostics.write(output.diagnostics_fh);
+                }
             }
-            // a body
-            else if (segs.size() == 4) {
-                Body body = Body();
-                body.x = std::stod(segs[0]);
-                body.y = std::stod(segs[1]);
-                body.vx = std::stod(segs[2]);
-                body.vy = std::stod(segs[3]);
-
-                bodies.push_back(body);
+
+            if (need_snapshot && rank == root) {
+                dump_timestep(t, bodies);
             }
-        }
 
-        input_fh.close();
+            bodies.barrier();
+        }
     }
+}
 
-    // we're going to throw bodies_n away here and let the Body vector
-    // be the source of truth for how many we have
-    assert(bodies_n == bodies.size());
-    assert(bodies_n == masses.size());
+typedef void (*Simulator)(Bodies&, unsigned int, double, const OutputConfig&, int);
 
-    for (size_t i = 0; i < bodies.size(); i++) {
-        bodies[i].m = masses[i];
-        bodies[i].Gm = G * masses[i];
+// Picks the one instantiation of simulate that this run needs, see
+// choose_policies
+struct SimulatorChooser {
+    typedef Simulator result_type;
+
+    template <class ForceEngine, class Integrator, class Precision>
+    static Simulator choose() {
+        return &simulate<ForceEngine, Integrator, Precision>;
     }
+};
+
+// A non-negative integer that fits in an int, for the interval and bin count
+// arguments. std::stoi alone would take "-1", which then wraps in an unsigned
+static bool is_count(const char *arg) {
+    char *end;
+    errno = 0;
+    const long value = strtol(arg, &end, 10);
 
-    return bodies;
+    return end != arg && *end == '\0' && errno == 0
+        && value >= 0 && value <= std::numeric_limits<int>::max();
 }
 
 int main(int argc, char **argv) {
-    if (argc != 6) {
-        fprintf(stdout, "numTimeSteps outputInterval deltaT inputFile enableBarnesHut\n");
+    // ensemble mode advances every system listed in a manifest, see
+    // parse_manifest for its format
+    const bool ENABLE_ENSEMBLE = (argc == 3 || argc == 4) && std::string(argv[1]) == "ensemble";
+
+    const bool valid_diagnostics_arguments = (argc <= 9 || is_count(argv[9]))
+        && (argc <= 11 || is_count(argv[11]))
+        && (argc <= 12 || is_count(argv[12]));
+
+    if (!ENABLE_ENSEMBLE && (argc < 6 || argc == 10 || argc > 13 || !valid_diagnostics_arguments)) {
+        fprintf(stdout, "numTimeSteps outputInterval deltaT inputFile enableBarnesHut [enableMixedPrecision] [softening] [integrator] [diagnosticsInterval diagnosticsFile [radialBins [potentialInterval]]]\n");
+        fprintf(stdout, "    integrator is one of leapfrog (default), euler, yoshida4 (aka forestruth), pefrl\n");
+        fprintf(stdout, "    an outputInterval or diagnosticsInterval of 0 turns that output off\n");
+        fprintf(stdout, "    diagnosticsInterval, radialBins (default 16) and potentialInterval are integers >= 0\n");
+        fprintf(stdout, "    the potential is an exact O(n^2) sum, only taken on diagnostics records every\n");
+        fprintf(stdout, "    potentialInterval steps (default diagnosticsInterval, 0 never); the rest write nan\n");
+        fprintf(stdout, "ensemble manifestFile [softening]\n");
         exit(1);
     }
 
@@ -257,148 +201,140 @@ int main(int argc, char **argv) {
 
     // ---------------------------------------------------------------------//
 
-    const unsigned int num_time_steps = std::stoi(argv[1]);
-    const unsigned int desired_simulation_steps = num_time_steps * (ENABLE_LEAPFROG ? 2 : 1);
+    if (ENABLE_ENSEMBLE) {
+        const std::string &manifest_filename = argv[2];
+        const double softening = argc > 3 ? std::stod(argv[3]) : 0;
 
-    const unsigned int output_interval = std::stoi(argv[2]);
-    const unsigned int output_simulation_step_interval = output_interval * (ENABLE_LEAPFROG ? 2 : 1);
+        Body::set_softening(softening);
+
+        if (!std::ifstream(manifest_filename).is_open()) {
+            if (rank == root) {
+                fprintf(stderr, "Could not open %s\n", manifest_filename.c_str());
+            }
+
+            MPI_Type_free(&MPI_Body);
+            MPI_Finalize();
+            exit(1);
+        }
+
+        double start = cpu_time();
+        const size_t systems_n = run_ensemble(manifest_filename, rank, size);
+
+        MPI_Type_free(&MPI_Body);
+        MPI_Finalize();
 
+        const double cpu_time_elapsed = cpu_time() - start;
+
+        fprintf(stderr, "\"%d\": %lf,\n", rank, cpu_time_elapsed);
+        fprintf(stderr, "\"systems%d\": %d,\n", rank, static_cast<int>(systems_n));
+
+        if (rank == 0) {
+            fprintf(stderr, "\"manifestFile\": \"%s\",\n", manifest_filename.c_str());
+            fprintf(stderr, "\"softening\": %lf,\n", softening);
+            fprintf(stderr, "\"ompMaxThreads\": %d,\n", omp_get_max_threads());
+            fprintf(stderr, "\"mpiCommSize\": %d,\n", size);
+        }
+
+        return 0;
+    }
+
+    // ---------------------------------------------------------------------//
+
+    const unsigned int num_time_steps = std::stoi(argv[1]);
+    const unsigned int output_interval = std::stoi(argv[2]);
     const double timestep = std::stod(argv[3]);
-    const double halfstep = timestep / 2;
 
     const std::string &input_filename = argv[4];
 
     const bool ENABLE_BARNES_HUT = std::stod(argv[5]) != 0; // big thonk
 
-    std::ifstream input_fh(input_filename);
+    // float32 interactions, double accumulation. Off unless asked for
+    const bool ENABLE_MIXED_PRECISION = argc > 6 && std::stod(argv[6]) != 0;
 
-    std::vector<Body> bodies = parse_input_file(input_fh);
-    const unsigned int bodies_n = bodies.size();
-
-    std::vector<int> send_counts = {};
-    std::vector<int> displacements = {};
+    // Plummer softening length. 0 is unsoftened
+    const double softening = argc > 7 ? std::stod(argv[7]) : 0;
+    Body::set_softening(softening);
 
-    int displacement_acc = 0;
-    int remainder = bodies_n;
-    int chunk = ceil(bodies_n / size);
+    const std::string integrator_name = argc > 8 ? argv[8] : "leapfrog";
+    IntegratorKind integrator;
 
+    if (!parse_integrator(integrator_name, integrator)) {
+        if (rank == root) {
+            fprintf(stderr, "Unknown integrator: %s\n", integrator_name.c_str());
+        }
 
-    while (remainder - chunk > 0) {
-        displacements.push_back(displacement_acc);
-        send_counts.push_back(chunk);
-        displacement_acc += (chunk);
-        remainder -= chunk;
+        MPI_Type_free(&MPI_Body);
+        MPI_Finalize();
+        exit(1);
     }
 
-    displacements.push_back(displacement_acc);
-    send_counts.push_back(remainder);
-
-    // fprintf(stderr, "Displacements\n");
-    // for (size_t i = 0; i < displacements.size(); i++) {
-    //     fprintf(stderr, "%d ", displacements[i]);
-    //
-    // }
-    // fprintf(stderr, "\n");
-    //
-    // fprintf(stderr, "Send counts\n");
-    // for (size_t i = 0; i < send_counts.size(); i++) {
-    //     fprintf(stderr, "%d ", send_counts[i]);
-    //
-    // }
-    // fprintf(stderr, "\n");
-
-    std::vector<Body> sbodies(send_counts[rank]);
+    // Reduced per-step records, written separately from (and usually far
+    // more often than) the full snapshots. See Diagnostics
+    OutputConfig output;
+    output.output_interval = output_interval;
+    output.diagnostics_interval = argc > 9 ? std::stoi(argv[9]) : 0;
+    output.radial_bins = argc > 11 ? std::stoi(argv[11]) : 16;
+    output.potential_interval = argc > 12 ? std::stoi(argv[12]) : output.diagnostics_interval;
+    output.diagnostics_fh = nullptr;
 
-    // ---------------------------------------------------------------------//
+    const std::string diagnostics_filename = argc > 10 ? argv[10] : "";
 
-    double t = 0; 
-    unsigned int step = 0;
+    if (output.diagnostics_interval != 0 && rank == root) {
+        output.diagnostics_fh = fopen(diagnostics_filename.c_str(), "w");
 
-    if (rank == root) {
-        dump_meta_info(num_time_steps, output_interval, timestep, bodies);
-        dump_masses(bodies);
-        dump_timestep(t, bodies);
+        if (output.diagnostics_fh == nullptr) {
+            fprintf(stderr, "Could not open %s for writing\n", diagnostics_filename.c_str());
+            MPI_Abort(comm, 1);
+        }
     }
 
-    // ---------------------------------------------------------------------//
+    // Only the root parses the input. Everyone else learns how many bodies
+    // there are, and then receives them through the node's shared window
+    std::vector<Body> input_bodies = {};
 
-    double start = cpu_time();
-    while (step < desired_simulation_steps) {
-        QuadTree qroot;
+    if (rank == root) {
+        std::ifstream input_fh(input_filename);
+        input_bodies = parse_input_file(input_fh);
+    }
 
-        // only the Frog step (not the Leap step) needs updated forces
-        // hence all the (step % 2 == FROG) tests
-        const bool need_force_calc = (rank == root) && (step % 2 == FROG);
+    unsigned int bodies_n = input_bodies.size();
+    MPI_Bcast(&bodies_n, 1, MPI_UNSIGNED, root, comm);
 
-        if (need_force_calc) {
-            if (ENABLE_BARNES_HUT) {
-                const double root_x = 0;
-                const double root_y = 0;
-                const double radius = maximum_deviation_from_root(bodies) + 1;
-                // the quad-tree uses half the width as an implementation detail
-                // called "radius". We're trying to make a QuadTree that encapsulates
-                // the most distant body
+    // ---------------------------------------------------------------------//
 
-                qroot = QuadTree(root_x, root_y, radius);
+    const Simulator simulator = choose_policies<SimulatorChooser>(
+        ENABLE_BARNES_HUT, integrator, ENABLE_MIXED_PRECISION
+    );
+    const unsigned int force_evaluations_per_step = choose_policies<ForceEvaluationsChooser>(
+        ENABLE_BARNES_HUT, integrator, ENABLE_MIXED_PRECISION
+    );
 
-                assert(qroot.insert_all(bodies));
-            }
+    double start;
+    int nodes_n;
 
-            #pragma omp parallel for shared(bodies)
-            for (size_t i = 0; i < bodies.size(); i++) {
-                auto& body = bodies[i];
-                body.reset_force();
+    // scoped, because the shared window has to be freed before MPI_Finalize
+    {
+        SharedBodies bodies(bodies_n, comm, MPI_Body);
+        bodies.distribute(input_bodies);
+        nodes_n = bodies.nodes_n;
 
-                if (ENABLE_BARNES_HUT) {
-                    qroot.calculate_force(body);
-                }
-            }
-
-            if (!ENABLE_BARNES_HUT) {
-                #pragma omp parallel for shared(bodies)
-                for (size_t i = 0; i < bodies.size(); i++) {
-                    auto& x = bodies[i];
-
-                    // Are we doing twice the work here by not doing all
-                    // pairwise combinations and exerting force
-                    // bidirectionally?
-                    // Yes!
-                    // Does doing it this way eliminate locking?
-                    // Also yes!
-                    // And does it provide a massive parallel speedup?
-                    // Damn straight it does
-                    for (size_t j = 0; j < bodies.size(); j++) {
-                        auto& y = bodies[j];
-
-                        if (&bodies[i] != &bodies[j]) {
-                            // XXX: Do NOT swap these around. You will cause
-                            // race conditions
-                            x.exert_force_unidirectionally(y);
-                        }
-                    }
-                }
-            }
+        if (rank == root) {
+            dump_meta_info(num_time_steps, output_interval, timestep, bodies);
+            dump_masses(bodies);
+            dump_timestep(0, bodies);
         }
 
-        for (size_t i = 0; i < bodies.size(); i++) {
-            auto& body = bodies[i];
+        bodies.barrier();
 
-            if (step % 2 == LEAP) {
-                body.leap(timestep);
-            }
-            else {
-                body.frog(timestep);
-            }
-        }
+        // ---------------------------------------------------------------------//
 
-        t += halfstep;
-        step++;
+        start = cpu_time();
 
-        if (rank == root) {
-            if (step % output_simulation_step_interval == 0) {
-                dump_timestep(t, bodies);
-            }
-        }
+        simulator(bodies, num_time_steps, timestep, output, rank);
+    }
+
+    if (output.diagnostics_fh != nullptr) {
+        fclose(output.diagnostics_fh);
     }
 
     MPI_Type_free(&MPI_Body);
@@ -413,15 +349,23 @@ int main(int argc, char **argv) {
     if (rank == 0) {
         fprintf(stderr, "\"numTimeSteps\": %d,\n", num_time_steps);
         fprintf(stderr, "\"outputInterval\": %d,\n", output_interval);
+        fprintf(stderr, "\"diagnosticsInterval\": %d,\n", output.diagnostics_interval);
+        fprintf(stderr, "\"potentialInterval\": %d,\n", output.potential_interval);
         fprintf(stderr, "\"deltaT\": %lf,\n", timestep);
         fprintf(stderr, "\"inputFile\": \"%s\",\n", input_filename.c_str());
 
         fprintf(stderr, "\"enableBarnesHut\": %d,\n", ENABLE_BARNES_HUT);
+        fprintf(stderr, "\"enableMixedPrecision\": %d,\n", ENABLE_MIXED_PRECISION);
+        fprintf(stderr, "\"softening\": %lf,\n", softening);
+        fprintf(stderr, "\"integrator\": \"%s\",\n", integrator_name.c_str());
+        fprintf(stderr, "\"forceEvaluations\": %lu,\n",
+            static_cast<unsigned long>(num_time_steps) * force_evaluations_per_step);
 
-        fprintf(stderr, "\"numBodies\": %d,\n", static_cast<int>(bodies.size()));
+        fprintf(stderr, "\"numBodies\": %d,\n", bodies_n);
 
         fprintf(stderr, "\"ompMaxThreads\": %d,\n", omp_get_max_threads());
         fprintf(stderr, "\"mpiCommSize\": %d,\n", size);
+        fprintf(stderr, "\"mpiNodes\": %d,\n", nodes_n);
     }
     
     return 0;
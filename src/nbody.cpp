@@ -0,0 +1,170 @@
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+#include "nbody.h"
+#include "Body.hpp"
+#include "Bodies.hpp"
+#include "Simulation.hpp"
+#include "utils.hpp"
+
+static_assert(NBODY_LEAPFROG == INTEGRATOR_LEAPFROG
+    && NBODY_EULER == INTEGRATOR_EULER
+    && NBODY_YOSHIDA4 == INTEGRATOR_YOSHIDA4
+    && NBODY_PEFRL == INTEGRATOR_PEFRL, "C API integrators must match IntegratorKind");
+
+// MPI_Body and the C API both rely on this layout
+static_assert(sizeof(Body) == NBODY_BODY_STRIDE * sizeof(double), "Body must be 8 packed doubles");
+static_assert(offsetof(Body, m) == NBODY_M * sizeof(double)
+    && offsetof(Body, Gm) == NBODY_GM * sizeof(double)
+    && offsetof(Body, x) == NBODY_X * sizeof(double)
+    && offsetof(Body, y) == NBODY_Y * sizeof(double)
+    && offsetof(Body, vx) == NBODY_VX * sizeof(double)
+    && offsetof(Body, vy) == NBODY_VY * sizeof(double)
+    && offsetof(Body, Fx) == NBODY_FX * sizeof(double)
+    && offsetof(Body, Fy) == NBODY_FY * sizeof(double), "C API field offsets must match Body");
+
+struct nbody_simulation {
+    // never resized after creation, so nbody_bodies stays valid
+    std::vector<Body> storage;
+    Bodies bodies;
+    double delta_t;
+    double t;
+    // Body's softening is one value for the whole process, so each simulation
+    // keeps its own and puts it in place whenever it's about to use it
+    double softening;
+    Stepper stepper;
+    double energies[3];
+
+    nbody_simulation(const std::vector<Body>& bodies):
+        storage(bodies),
+        bodies(storage.data(), storage.size()) {
+    }
+};
+
+static nbody_simulation *create(
+    std::vector<Body> bodies,
+    double delta_t,
+    int enable_barnes_hut,
+    int enable_mixed_precision,
+    double softening,
+    int integrator
+) {
+    if (bodies.empty() || integrator < NBODY_LEAPFROG || integrator > NBODY_PEFRL) {
+        return nullptr;
+    }
+
+    // nothing may throw across the C boundary
+    try {
+        nbody_simulation *simulation = new nbody_simulation(bodies);
+        simulation->delta_t = delta_t;
+        simulation->t = 0;
+        simulation->softening = softening;
+        simulation->stepper = choose_policies<StepperChooser>(
+            enable_barnes_hut != 0, static_cast<IntegratorKind>(integrator), enable_mixed_precision != 0
+        );
+
+        return simulation;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+nbody_simulation *nbody_create(
+    size_t n,
+    const double *m,
+    const double *x,
+    const double *y,
+    const double *vx,
+    const double *vy,
+    double delta_t,
+    int enable_barnes_hut,
+    int enable_mixed_precision,
+    double softening,
+    int integrator
+) {
+    std::vector<Body> bodies;
+
+    try {
+        bodies.resize(n);
+    } catch (...) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        bodies[i].m = m[i];
+        bodies[i].Gm = G * m[i];
+        bodies[i].x = x[i];
+        bodies[i].y = y[i];
+        bodies[i].vx = vx[i];
+        bodies[i].vy = vy[i];
+    }
+
+    return create(bodies, delta_t, enable_barnes_hut, enable_mixed_precision, softening, integrator);
+}
+
+nbody_simulation *nbody_create_from_file(
+    const char *input_filename,
+    double delta_t,
+    int enable_barnes_hut,
+    int enable_mixed_precision,
+    double softening,
+    int integrator
+) {
+    std::ifstream input_fh(input_filename);
+
+    if (!input_fh.is_open()) {
+        return nullptr;
+    }
+
+    std::vector<Body> bodies;
+
+    try {
+        if (!try_parse_input_file(input_fh, bodies)) {
+            return nullptr;
+        }
+    } catch (...) {
+        // std::stod on a malformed number
+        return nullptr;
+    }
+
+    return create(bodies, delta_t, enable_barnes_hut, enable_mixed_precision, softening, integrator);
+}
+
+void nbody_destroy(nbody_simulation *simulation) {
+    delete simulation;
+}
+
+void nbody_step(nbody_simulation *simulation, unsigned int num_time_steps) {
+    Body::set_softening(simulation->softening);
+
+    for (unsigned int step = 0; step < num_time_steps; step++) {
+        simulation->stepper(simulation->bodies, simulation->delta_t);
+        simulation->t += simulation->delta_t;
+    }
+}
+
+size_t nbody_size(const nbody_simulation *simulation) {
+    return simulation->bodies.size();
+}
+
+double nbody_time(const nbody_simulation *simulation) {
+    return simulation->t;
+}
+
+double *nbody_bodies(nbody_simulation *simulation) {
+    return reinterpret_cast<double *>(simulation->bodies.data);
+}
+
+const double *nbody_energies(nbody_simulation *simulation) {
+    Body::set_softening(simulation->softening);
+
+    const double kinetic = calculate_kinetic_energy(simulation->bodies);
+    const double potential = calculate_gravitational_potential_energy(simulation->bodies);
+
+    simulation->energies[0] = kinetic;
+    simulation->energies[1] = potential;
+    simulation->energies[2] = kinetic + potential;
+
+    return simulation->energies;
+}
@@ -0,0 +1,88 @@
+#ifndef _nbody_h
+#define _nbody_h
+#include <stddef.h>
+
+/*  C API for embedding the simulation in another process, e.g. through Python's
+    ctypes (see nbody.py). Build it with `make lib`.
+
+    Body state is never copied out. nbody_bodies returns the simulation's own
+    array of bodies, NBODY_BODY_STRIDE doubles per body, laid out as
+
+        m Gm x y vx vy Fx Fy
+
+    and the array stays valid (and at the same address) until nbody_destroy.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NBODY_BODY_STRIDE 8
+
+#define NBODY_M 0
+#define NBODY_GM 1
+#define NBODY_X 2
+#define NBODY_Y 3
+#define NBODY_VX 4
+#define NBODY_VY 5
+#define NBODY_FX 6
+#define NBODY_FY 7
+
+/* integrators, see Simulation.hpp */
+#define NBODY_LEAPFROG 0
+#define NBODY_EULER 1
+#define NBODY_YOSHIDA4 2
+#define NBODY_PEFRL 3
+
+typedef struct nbody_simulation nbody_simulation;
+
+/* Returns NULL if n is 0 or integrator isn't one of the above. Each
+   simulation keeps its own softening, but they share the process's copy while
+   stepping, so don't step (or take the energies of) two simulations from
+   different threads at once */
+nbody_simulation *nbody_create(
+    size_t n,
+    const double *m,
+    const double *x,
+    const double *y,
+    const double *vx,
+    const double *vy,
+    double delta_t,
+    int enable_barnes_hut,
+    int enable_mixed_precision,
+    double softening,
+    int integrator
+);
+
+/* Reads the same input file format as the nbody binary. Returns NULL if the
+   file can't be read or is malformed, e.g. the counts don't match the header */
+nbody_simulation *nbody_create_from_file(
+    const char *input_filename,
+    double delta_t,
+    int enable_barnes_hut,
+    int enable_mixed_precision,
+    double softening,
+    int integrator
+);
+
+void nbody_destroy(nbody_simulation *simulation);
+
+/* Advances the simulation by num_time_steps steps of delta_t */
+void nbody_step(nbody_simulation *simulation, unsigned int num_time_steps);
+
+size_t nbody_size(const nbody_simulation *simulation);
+double nbody_time(const nbody_simulation *simulation);
+
+/* n * NBODY_BODY_STRIDE doubles, see above */
+double *nbody_bodies(nbody_simulation *simulation);
+
+/* kinetic, gravitational potential and total energy. They cost O(n^2), so
+   they're only brought up to date by calling this, not by nbody_step. The
+   returned array is the simulation's own, and valid until nbody_destroy */
+const double *nbody_energies(nbody_simulation *simulation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,15 @@
+#include <stdio.h>
 #include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <algorithm>
+
 #include "Body.hpp"
+#include "Bodies.hpp"
+#include "utils.hpp"
 
 double distance(double x1, double y1, double x2, double y2) {
     const double a = x1 - x2;
@@ -10,4 +20,133 @@ double distance(double x1, double y1, double x2, double y2) {
 
 double distance(const Body& here, const Body& there) {
     return distance(here.x, here.y, there.x, there.y);
-}
\ No newline at end of file
+}
+
+// How far the furthest body is from the root of the quad-tree, which sits at
+// the origin, along either axis. The spread of the bodies (highest - lowest)
+// isn't enough: a cluster away from the origin can lie outside a root that
+// wide, and then fails to insert
+double maximum_deviation_from_root(const Bodies& bodies) {
+    double deviation = 0;
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        auto& body = bodies[i];
+
+        deviation = std::max(deviation, std::fabs(body.x));
+        deviation = std::max(deviation, std::fabs(body.y));
+    }
+
+    return deviation;
+}
+
+double calculate_kinetic_energy(const Bodies& bodies) {
+    double acc = 0;
+
+    #pragma omp parallel for reduction(+:acc)
+    for (size_t i = 0; i < bodies.size(); i++) {
+        auto& body = bodies[i];
+        acc += body.kinetic_energy();
+    }
+
+    return acc;
+}
+
+double calculate_gravitational_potential_energy(const Bodies& bodies) {
+    double acc = 0;
+
+    #pragma omp parallel for reduction(+:acc)
+    for (size_t i = 0; i < bodies.size() - 1; i++) {
+        auto& x = bodies[i];
+
+        for (size_t j = i + 1; j < bodies.size(); j++) {
+            auto& y = bodies[j];
+
+            acc += x.gravitational_potential_energy(y);
+        }
+    }
+    
+    return acc;
+}
+
+double calculate_total_energy(const Bodies& bodies) {
+    return calculate_gravitational_potential_energy(bodies) 
+        + calculate_kinetic_energy(bodies);
+}
+
+/*
+numBodies
+Mass1
+Mass2
+...
+massN
+0.00 totalEnergy
+x1 y1 vx1 vy1
+..
+xN yN vxN vyN
+*/
+bool try_parse_input_file(std::ifstream& input_fh, std::vector<Body>& bodies) {
+    // not a Body&; we want to maximise cache locality
+    bodies.clear();
+    std::vector<double> masses = {};
+    std::string line;
+
+    unsigned int bodies_n = 0;
+
+    if (input_fh.is_open()) {
+        // numBodies
+        getline(input_fh, line);
+        sscanf(line.c_str(), "%u", &bodies_n);
+
+        while (getline(input_fh, line)) {
+            std::stringstream line_stream(line);
+            std::string segment;
+            std::vector<std::string> segs;
+
+            while (getline(line_stream, segment, ' ')) {
+                segs.push_back(segment);
+            }
+
+            // a mass
+            if (segs.size() == 1) {
+                masses.push_back(std::stod(segs[0]));
+            } 
+            // a total energy description
+            else if (segs.size() == 2) { 
+            }
+            // a body
+            else if (segs.size() == 4) {
+                Body body = Body();
+                body.x = std::stod(segs[0]);
+                body.y = std::stod(segs[1]);
+                body.vx = std::stod(segs[2]);
+                body.vy = std::stod(segs[3]);
+
+                bodies.push_back(body);
+            }
+        }
+
+        input_fh.close();
+    }
+
+    // we're going to throw bodies_n away here and let the Body vector
+    // be the source of truth for how many we have
+    if (bodies_n != bodies.size() || bodies_n != masses.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies[i].m = masses[i];
+        bodies[i].Gm = G * masses[i];
+    }
+
+    return true;
+}
+
+std::vector<Body> parse_input_file(std::ifstream& input_fh) {
+    std::vector<Body> bodies;
+    const bool did_parse = try_parse_input_file(input_fh, bodies);
+    assert(did_parse);
+    (void)did_parse;
+
+    return bodies;
+}
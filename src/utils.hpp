@@ -1,7 +1,18 @@
 #ifndef _utils_h
 #define _utils_h
+#include "Body.hpp"
+#include "Bodies.hpp"
+#include <fstream>
+#include <vector>
 
 double distance(double x1, double y1, double x2, double y2);
 double distance(const Body &here, const Body &there);
+double maximum_deviation_from_root(const Bodies& bodies);
+double calculate_kinetic_energy(const Bodies& bodies);
+double calculate_gravitational_potential_energy(const Bodies& bodies);
+double calculate_total_energy(const Bodies& bodies);
+// false if the body and mass counts don't match the header; std::stod can throw
+bool try_parse_input_file(std::ifstream& input_fh, std::vector<Body>& bodies);
+std::vector<Body> parse_input_file(std::ifstream& input_fh);
 
 #endif
\ No newline at end of file